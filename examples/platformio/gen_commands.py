@@ -0,0 +1,10 @@
+# pre build script, generates the command table for the example.
+Import("env")
+import os
+import subprocess
+
+project = env.subst("$PROJECT_DIR")
+subprocess.check_call([env.subst("$PYTHONEXE"),
+                       os.path.join(project, "..", "..", "tools", "mkcommands.py"),
+                       os.path.join(project, "src", "commands.def"),
+                       os.path.join(project, "src", "commands_table.c")])
@@ -1,24 +1,60 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
-#include "editline.h"
+#include "editline_commands.h"
+#include "commands.def"
 #include "setup_stdio.h"
 
 struct editline elstate = EDITLINE_INIT;
+extern const struct editline_cmdtab editline_commands;
 
+#if !ENABLE_TXQUEUE
 void user_putchar(char ch)
 {
         putchar((unsigned char)ch);
 }
+#endif
+
+int cmd_help(int argc, char **argv)
+{
+        editline_help(&editline_commands);
+        return 0;
+}
+
+int cmd_echo(int argc, char **argv)
+{
+        for (int i = 1; i < argc; i++)
+                printf("<%s>", argv[i]);
+        putchar('\n');
+        return 0;
+}
+
+int cmd_status(int argc, char **argv)
+{
+        printf("%d characters dropped\n", input_queue.overflow);
+#if ENABLE_STATS
+        struct editline_stats st;
+        editline_get_stats(&elstate, &st, false);
+        printf("%lu keys, %lu bytes out, %lu redraws, %lu repaints\n",
+               (unsigned long)st.keys, (unsigned long)st.bytes_out,
+               (unsigned long)st.redraws, (unsigned long)st.repaints);
+        printf("%lu bytes moved, %lu history promotions, %lu unknown escapes\n",
+               (unsigned long)st.moved, (unsigned long)st.promotions,
+               (unsigned long)st.unknown_escapes);
+#endif
+        return 0;
+}
 
 int main()
 {
         setup_stdio();
-        /* we loop here since we cannot tell if someone is listening on arduino */
-        while (!char_available());
-        /* we seed the char with ^L for a forced initial redraw. */
-        for (int ch = CTL('L'); ch != EOF; ch = getchar()) {
-                switch (editline_process_char(&elstate, ch)) {
+        /* we wait here since we cannot tell if someone is listening on arduino */
+        if (!wait_input())
+                return 0;
+        /* we seed with ^L for a forced initial redraw. */
+        for (int ret = editline_process_char(&elstate, CTL('L'));;
+                        ret = editline_process_queue(&elstate, &input_queue)) {
+                switch (ret) {
                 case EL_REDRAW:
                         reserve_statuslines(&elstate, 4);
                         begin_statusline(&elstate, 0);
@@ -29,28 +65,40 @@ int main()
                         puts("^H backspace M-q to exit example.");
                         end_statusline(&elstate);
                         break;
-                case EL_COMMAND:
-                        if (elstate.buf[0]) {
-                                putchar('<');
-                                for (char *c = elstate.buf; *c; c++)
-                                        putchar(*c);
-                                putchar('>');
-                                putchar('\n');
+                case EL_COMMAND: {
+                        bool keep = !strchr(elstate.buf, 'x');
+                        switch (editline_dispatch(&elstate, &editline_commands)) {
+                        case EL_CMD_SYNTAX:
+                                puts("?");
+                                break;
+                        case EL_CMD_UNKNOWN:
+                                puts("unknown command, try help");
+                                break;
+                        case EL_CMD_TOOMANY:
+                                puts("too many arguments");
+                                break;
                         }
-                        editline_command_complete(&elstate, !strchr(elstate.buf, 'x'));
+                        editline_command_complete(&elstate, keep);
                         break;
+                }
                 case EL_UNKNOWN:
                         /* quit on meta-q */
                         if (elstate.key == META('q'))
                                 return 0;
+                        if (elstate.key == CTL('I'))
+                                editline_complete_command(&elstate, &editline_commands);
                         break;
                 default:
                         break;
                 }
                 begin_statusline(&elstate, 3);
                 debug_color_char(elstate.key);
+                if (input_queue.overflow)
+                        printf(" dropped %d", input_queue.overflow);
                 end_statusline(&elstate);
                 fflush(stdout);
+                if (!editline_rxq_pending(&input_queue) && !wait_input())
+                        break;
         }
         return 0;
 }
@@ -1,27 +1,40 @@
 #include <stdio.h>
 #include "setup_stdio.h"
 
+struct editline_rxq input_queue = EDITLINE_RXQ_INIT;
+
 #ifdef __AVR__
 
 #include <avr/power.h>
-
-#define SERIAL_BUFFER_SIZE 32
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
 
 static int cput(char, FILE *);
-static int cget(FILE *);
 
-static FILE IO = FDEV_SETUP_STREAM(cput, cget, _FDEV_SETUP_RW);
+static FILE IO = FDEV_SETUP_STREAM(cput, NULL, _FDEV_SETUP_WRITE);
 
-bool char_available(void)
+ISR(USART_RX_vect)
 {
-        return UCSR0A & _BV(RXC0);
+        editline_rxq_push(&input_queue, UDR0);
 }
 
-static int
-cget(FILE *f)
+bool wait_input(void)
 {
-        loop_until_bit_is_set(UCSR0A, RXC0);
-        return UDR0;
+        /*
+         * the receive interrupt wakes us up. Interrupts stay off between the
+         * check and sleeping, sei only takes effect after the next
+         * instruction so a byte arriving in between still wakes sleep_cpu.
+         */
+        cli();
+        while (!editline_rxq_pending(&input_queue)) {
+                sleep_enable();
+                sei();
+                sleep_cpu();
+                sleep_disable();
+                cli();
+        }
+        sei();
+        return true;
 }
 
 
@@ -35,12 +48,36 @@ setup_stdio(void)
         UBRR0H = UBRRH_VALUE;
         UBRR0L = UBRRL_VALUE;
         UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
-        UCSR0B = _BV(RXEN0) | _BV(TXEN0);
+        UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
         stdout = &IO;
         stderr = &IO;
-        stdin = &IO;
+        sei();
+}
+
+#if ENABLE_TXQUEUE
+ISR(USART_UDRE_vect)
+{
+        char c;
+        if (editline_tx_drain(&c, 1))
+                UDR0 = c;
+        else
+                UCSR0B &= ~_BV(UDRIE0);
+}
+
+void user_tx_kick(void)
+{
+        UCSR0B |= _BV(UDRIE0);
 }
 
+static int
+cput(char c, FILE *f)
+{
+        if (c == '\n')
+                editline_putchar('\r');
+        editline_putchar(c);
+        return 0;
+}
+#else
 static int
 cput(char c, FILE *f)
 {
@@ -52,6 +89,7 @@ cput(char c, FILE *f)
         UDR0 = c;
         return 0;
 }
+#endif
 #else
 
 #include <termios.h>
@@ -84,9 +122,23 @@ void setup_stdio(void)
         atexit(reset_stdio);
 }
 
-bool char_available(void)
+#if ENABLE_TXQUEUE
+void user_tx_kick(void)
 {
-        return true;
+        char buf[EDITLINE_TXQUEUE_SIZE];
+        fwrite(buf, 1, editline_tx_drain(buf, sizeof(buf)), stdout);
+}
+#endif
+
+bool wait_input(void)
+{
+        /* read as much as is ready so pastes are processed in one batch */
+        char buf[EDITLINE_RXQUEUE_SIZE];
+        int n = EDITLINE_RXQUEUE_SIZE - editline_rxq_pending(&input_queue);
+        n = read(STDIN_FILENO, buf, n);
+        for (int i = 0; i < n; i++)
+                editline_rxq_push(&input_queue, buf[i]);
+        return n > 0;
 }
 #endif
 
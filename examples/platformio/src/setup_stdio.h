@@ -2,13 +2,17 @@
 #define SETUP_STDIO_H
 
 #include <stdbool.h>
+#include "editline.h"
 
+/* characters typed at the terminal, on AVR these are queued by the receive
+ * interrupt. */
+extern struct editline_rxq input_queue;
 
 /* set up stdio at 38400 baud on AVR and initializes the terminal in native. */
 void setup_stdio(void);
 
-/* check if character might be available, just a hint. */
-bool char_available(void);
+/* wait until input_queue has something in it. returns false on end of file. */
+bool wait_input(void);
 
 
 #endif /* end of include guard: SETUP_STDIO_H */
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "editline_commands.h"
+#include "editline_telnet.h"
+#include "commands.def"
+
+extern const struct editline_cmdtab editline_commands;
+
+#define out(...) editline_telnet_printf(editline_telnet_current(), __VA_ARGS__)
+
+int cmd_help(int argc, char **argv)
+{
+        editline_help(&editline_commands);
+        return 0;
+}
+
+int cmd_echo(int argc, char **argv)
+{
+        for (int i = 1; i < argc; i++)
+                out("<%s>", argv[i]);
+        out("\n");
+        return 0;
+}
+
+int cmd_who(int argc, char **argv)
+{
+        for (struct editline_session *s = editline_telnet_sessions(); s; s = s->next)
+                out("fd %d %dx%d%s\n", s->fd, s->width, s->height,
+                    s == editline_telnet_current() ? " (you)" : "");
+        return 0;
+}
+
+int cmd_wall(int argc, char **argv)
+{
+        char msg[EDITLINE_BUFSIZE + 32];
+        int n = snprintf(msg, sizeof(msg), "fd %d says:", editline_telnet_current()->fd);
+        for (int i = 1; i < argc && n < (int)sizeof(msg); i++)
+                n += snprintf(msg + n, sizeof(msg) - n, " %s", argv[i]);
+        if (n > (int)sizeof(msg) - 2)
+                n = sizeof(msg) - 2;
+        strcpy(msg + n, "\n");
+        for (struct editline_session *s = editline_telnet_sessions(); s; s = s->next)
+                if (s != editline_telnet_current())
+                        editline_telnet_message(s, msg);
+        return 0;
+}
+
+int cmd_quit(int argc, char **argv)
+{
+        out("bye\n");
+        editline_telnet_close(editline_telnet_current());
+        return 0;
+}
+
+int cmd_shutdown(int argc, char **argv)
+{
+        editline_telnet_stop();
+        return 0;
+}
+
+static void event(struct editline_session *s, int ev)
+{
+        switch (ev) {
+        case EL_CONNECT:
+                out("tiny editline over telnet, try help\n");
+                break;
+        case EL_REDRAW:
+                reserve_statuslines(&s->el, 1);
+                begin_statusline(&s->el, 0);
+                out("^P/^N history, tab completes, window %dx%d", s->width, s->height);
+                end_statusline(&s->el);
+                break;
+        case EL_COMMAND:
+                switch (editline_dispatch(&s->el, &editline_commands)) {
+                case EL_CMD_SYNTAX:
+                        out("?\n");
+                        break;
+                case EL_CMD_UNKNOWN:
+                        out("unknown command, try help\n");
+                        break;
+                case EL_CMD_TOOMANY:
+                        out("too many arguments\n");
+                        break;
+                }
+                editline_command_complete(&s->el, true);
+                break;
+        case EL_UNKNOWN:
+                if (s->el.key == CTL('I'))
+                        editline_complete_command(&s->el, &editline_commands);
+                break;
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        int port = argc > 1 ? atoi(argv[1]) : 2323;
+        int fd = editline_telnet_listen(NULL, port);
+        if (fd < 0) {
+                perror("listen");
+                return 1;
+        }
+        printf("listening on port %d\n", port);
+        if (editline_telnet_serve(fd, event) < 0) {
+                perror("serve");
+                return 1;
+        }
+        return 0;
+}
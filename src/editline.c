@@ -1,6 +1,9 @@
 #define _GNU_SOURCE 1
 
 #include "editline.h"
+#if ENABLE_BINARY
+#include "editline_binary.h"
+#endif
 
 #if !ENABLE_DEBUG && !defined(NDEBUG)
 #define NDEBUG
@@ -22,12 +25,159 @@ static char *buf(struct editline *s)
 #endif
 }
 
+#if ENABLE_STATS
+/*
+ * Output has no instance of its own so it is counted against the one passed to
+ * the last public entry point that writes anything, which sets out_state.
+ */
+static struct editline *out_state;
+
+#define STAT(s, f)              ((s)->stats.f++)
+#define STAT_ADD(s, f, n)       ((s)->stats.f += (n))
+#define COUNT_OUTPUT(s)         (out_state = (s))
+
+static void count_out(void)
+{
+        if (out_state)
+                out_state->stats.bytes_out++;
+}
+
+void editline_get_stats(struct editline *s, struct editline_stats *out, bool reset)
+{
+        *out = s->stats;
+        if (reset)
+                memset(&s->stats, 0, sizeof(s->stats));
+}
+#else
+#define STAT(s, f)
+#define STAT_ADD(s, f, n)
+#define COUNT_OUTPUT(s)
+#define count_out()     ((void)0)
+#endif
+
+/* the queues index with free running uint8_t counters */
+#define QUEUE_SIZE_OK(n)        ((n) > 0 && (n) <= 128 && !((n) & ((n) - 1)))
+
+#if ENABLE_TXQUEUE
+_Static_assert(QUEUE_SIZE_OK(EDITLINE_TXQUEUE_SIZE),
+               "EDITLINE_TXQUEUE_SIZE must be a power of two, at most 128");
+
+/*
+ * Output queue drained by editline_tx_drain. Line editing output from a single
+ * key starts a collapsible run at 'mark', when a full redraw of the command is
+ * queued while nothing of the run has been sent yet the drain skips straight
+ * from 'mark' to the redraw at 'to'. Anything else, such as newlines, status
+ * lines or user output, is a barrier that ends the run.
+ *
+ * 'open' says later redraws may still extend the run, a barrier clears it but
+ * leaves a skip already armed in 'skip' for the drain to take. The drain
+ * clears both once it reaches 'mark', the producer sets 'to' before 'skip'
+ * so an interrupt never sees a half updated skip. A new run waits for an
+ * armed skip to be taken as there is only the one 'mark'.
+ */
+static struct {
+        volatile uint8_t head, tail, mark, to;
+        volatile bool open, skip;
+        volatile char buf[EDITLINE_TXQUEUE_SIZE];
+} txq;
+
+static void tx_put(char ch)
+{
+        while ((uint8_t)(txq.head - txq.tail) >= EDITLINE_TXQUEUE_SIZE)
+                user_tx_kick();
+        txq.buf[txq.head & (EDITLINE_TXQUEUE_SIZE - 1)] = ch;
+        txq.head++;
+        user_tx_kick();
+}
+
+static void el_putchar(char ch)
+{
+        count_out();
+        tx_put(ch);
+}
+
+static void tx_begin_run(void)
+{
+        if (!txq.open && !txq.skip) {
+                txq.mark = txq.head;
+                txq.open = true;
+        }
+}
+
+static void tx_barrier(void)
+{
+        txq.open = false;
+}
+
+#if !ENABLE_BINARY && !ENABLE_MULTILINE
+/* called at the start of a full redraw, binary output is a stream of changes
+ * so it never collapses, nor does multiline output which tracks its row */
+static void tx_supersede(void)
+{
+        if (txq.open) {
+                txq.to = txq.head;
+                txq.skip = true;
+                /* the drain got to mark first and started sending the run */
+                if (!txq.open)
+                        txq.skip = false;
+        }
+}
+#endif
+
+void editline_putchar(char ch)
+{
+        tx_barrier();
+#if ENABLE_BINARY
+        if (ISMETA(ch))
+                tx_put(EL_OP(EL_OP_CTL, EL_CTL_LIT));
+#endif
+        tx_put(ch);
+}
+
+uint8_t editline_tx_pending(void)
+{
+        return txq.head - txq.tail;
+}
+
+int editline_tx_drain(char *dst, int max)
+{
+        int n = 0;
+        while (n < max && txq.tail != txq.head) {
+                if ((txq.open || txq.skip) && txq.tail == txq.mark) {
+                        txq.open = false;
+                        if (txq.skip) {
+                                txq.skip = false;
+                                txq.tail = txq.to;
+                                continue;
+                        }
+                }
+                dst[n++] = txq.buf[txq.tail & (EDITLINE_TXQUEUE_SIZE - 1)];
+                txq.tail++;
+        }
+        return n;
+}
+#else
+#define el_putchar(ch)  (count_out(), user_putchar(ch))
+#define tx_begin_run()
+#define tx_barrier()
+#define tx_supersede()
+
+void editline_putchar(char ch)
+{
+#if ENABLE_BINARY
+        if (ISMETA(ch))
+                user_putchar(EL_OP(EL_OP_CTL, EL_CTL_LIT));
+#endif
+        user_putchar(ch);
+}
+#endif
+
 /* terminal commands */
 
 static void putchar2(char x, char y)
 {
-        user_putchar(x);
-        user_putchar(y);
+        el_putchar(x);
+        el_putchar(y);
 }
 
 
@@ -38,7 +188,7 @@ static void putnum(unsigned short n)
                 *s++ = n % 10 + '0';
         } while ((n /= 10) > 0);
         while (s-- != buf)
-                user_putchar(*s);
+                el_putchar(*s);
 }
 
 
@@ -46,7 +196,7 @@ static void csi_n(int num, char ch)
 {
         putchar2('\033', '[');
         putnum(num);
-        user_putchar(ch);
+        el_putchar(ch);
 }
 
 /* static void csi_nn(int x, int y,  char ch) { */
@@ -58,30 +208,380 @@ static void csi_n(int num, char ch)
 static void csi(char ch)
 {
         putchar2('\033', '[');
-        user_putchar(ch);
+        el_putchar(ch);
+}
+
+#if ENABLE_BINARY
+/*
+ * Binary backend, see editline_binary.h. Instead of drawing, changes to the
+ * line are sent as operations on the host's copy of it.
+ */
+static void op(uint8_t code, uint8_t n)
+{
+        if (n < EL_OP_EXT) {
+                el_putchar(EL_OP(code, n));
+        } else {
+                el_putchar(EL_OP(code, EL_OP_EXT));
+                el_putchar(n);
+        }
+}
+
+static void op_text(uint8_t code, const char *s, uint8_t n)
+{
+        op(code, n);
+        while (n--)
+                el_putchar(*s++);
+}
+
+static void ctl(uint8_t c)
+{
+        op(EL_OP_CTL, c);
+}
+
+/* index of the history entry being shown */
+static uint8_t hist_index(struct editline *state)
+{
+        uint8_t n = 0;
+        for (int i = 0; i < state->hcur; i++)
+                n += !state->buf[i];
+        return n;
+}
+
+static void cursor_to(struct editline *state, uint8_t from, uint8_t to)
+{
+        if (from == to)
+                return;
+        if (to < from && from - to < EL_OP_EXT)
+                op(EL_OP_LEFT, from - to);
+        else if (to > from && to - from < EL_OP_EXT)
+                op(EL_OP_RIGHT, to - from);
+        else
+                op(EL_OP_CUR, to);
+}
+
+static void
+redraw_current_command(struct editline *state)
+{
+        STAT(state, redraws);
+        ctl(EL_CTL_LINE);
+        el_putchar(hist_index(state));
+        el_putchar(state->len);
+        for (int i = 0; i < state->len; i++)
+                el_putchar(state->buf[state->hcur + i]);
+        el_putchar(state->pos);
+}
+
+static void show_insert(struct editline *state, uint8_t n)
+{
+        STAT(state, repaints);
+        op_text(EL_OP_INS, state->buf + state->pos, n);
+        state->pos += n;
+}
+
+static void show_delete(struct editline *state, uint8_t n)
+{
+        if (!n)
+                return;
+        STAT(state, repaints);
+        op(EL_OP_DEL, n);
+}
+
+static void show_overwrite(struct editline *state, uint8_t n)
+{
+        if (!n)
+                return;
+        STAT(state, repaints);
+        op_text(EL_OP_OVR, state->buf + state->pos, n);
+}
+
+static void show_history(struct editline *state)
+{
+        op(EL_OP_HIST, hist_index(state));
+}
+
+#define show_newline(s)         ctl(EL_CTL_NEWLINE)
+#define show_cleared(s)         ctl(EL_CTL_CLEAR)
+#define show_realized(copy)     ctl((copy) ? EL_CTL_COPY : EL_CTL_MOVE)
+#define show_committed(s, keep) ctl((keep) ? EL_CTL_KEEP : EL_CTL_DROP)
+#define hide_line(s)            ctl(EL_CTL_HIDE)
+#define restore_line(s)         ctl(EL_CTL_SHOW)
+#define clear_screen()          ctl(EL_CTL_SCREEN)
+
+static void status_reserve(int n)
+{
+        ctl(EL_CTL_RESERVE);
+        el_putchar(n);
 }
 
+static void status_begin(struct editline *state, int n)
+{
+        ctl(EL_CTL_STATUS);
+        el_putchar(n);
+}
+
+#define status_end(s)           ctl(EL_CTL_STATUS_END)
+#else
 static void show_cursor(bool show)
 {
         csi('?');
         putchar2('2', '5');
-        user_putchar(show ? 'h' : 'l');
+        el_putchar(show ? 'h' : 'l');
 }
 
 
-static void move_cursor(int8_t n)
+static void move_cursor(int n)
 {
         if (n)
                 csi_n(n > 0 ? n : -n, n > 0 ? 'C' : 'D');
 }
 
+static void show_prompt(void)
+{
+        if (EDITLINE_PROMPT) {
+                csi_n(92, 'm');
+                el_putchar(EDITLINE_PROMPT);
+                csi('m');
+        }
+}
+
+#if ENABLE_MULTILINE
+/*
+ * Multiline output. The command is laid out in rows, a row ends before the
+ * last column of the terminal or after a newline, which itself is not shown,
+ * and a full row is always followed by another so the cursor never sits in the
+ * last column either. The rows are cached in rowstart and an edit only lays
+ * out again from the row it starts in to the first row following a newline
+ * past it, the rows after that just shift. Only the rows whose text changed
+ * are repainted and cursor movement is relative to crow, the row the cursor
+ * is on.
+ */
+#define PROMPT_COLS     (EDITLINE_PROMPT ? 1 : 0)
+
+static uint8_t nrows(struct editline *s)
+{
+        return s->nrows ? s->nrows : 1;
+}
+
+/* characters that fit on row r */
+static uint8_t row_width(struct editline *s, uint8_t r)
+{
+        return (s->cols ? s->cols : EDITLINE_COLUMNS) - 1 - (r ? 0 : PROMPT_COLS);
+}
+
+static uint8_t row_of(struct editline *s, uint8_t i)
+{
+        uint8_t r = nrows(s) - 1;
+        while (r && s->rowstart[r] > i)
+                r--;
+        return r;
+}
+
+static uint8_t row_end(struct editline *s, uint8_t r)
+{
+        return r + 1 < nrows(s) ? s->rowstart[r + 1] : s->len;
+}
+
+static uint8_t col_of(struct editline *s, uint8_t r, uint8_t i)
+{
+        uint8_t c = i - s->rowstart[r];
+        if (c > row_width(s, r))
+                c = row_width(s, r);
+        return (r ? 0 : PROMPT_COLS) + c;
+}
+
+/*
+ * The command changed from 'from' up to 'end', growing by delta. Lay it out
+ * again and return the last row that needs repainting.
+ */
+static uint8_t relayout(struct editline *s, uint8_t from, uint8_t end, int delta)
+{
+        const char *b = buf(s);
+        uint8_t old[EDITLINE_MAXROWS], on = nrows(s), r = row_of(s, from);
+        /* a newline at 'from' may belong to the row before, if that is full */
+        if (r)
+                r--;
+        uint8_t i = s->rowstart[r];
+        memcpy(old, s->rowstart, on);
+        for (;; r++) {
+                uint8_t e = i, w = row_width(s, r);
+                while (e < s->len && e - i < w && b[e] != '\n')
+                        e++;
+                if (e < s->len && b[e] == '\n')
+                        e++;
+                else if (e - i < w)
+                        break;
+                if (r + 1 == EDITLINE_MAXROWS)
+                        break;
+                s->rowstart[r + 1] = i = e;
+                if (b[e - 1] != '\n' || e <= end || on == EDITLINE_MAXROWS)
+                        continue;
+                /* past the change, rows after a newline are the same as before */
+                for (uint8_t k = 1; k < on; k++) {
+                        if (old[k] != e - delta)
+                                continue;
+                        bool moved = r + 1 != k;
+                        for (; k < on && r + 1 < EDITLINE_MAXROWS; k++)
+                                s->rowstart[++r] = old[k] + delta;
+                        s->nrows = r + 1;
+                        return moved ? r : row_of(s, e - 1);
+                }
+        }
+        s->nrows = r + 1;
+        return r;
+}
+
+/* move the cursor from column c on crow to row r column to */
+static void goto_row(struct editline *s, uint8_t c, uint8_t r, uint8_t to)
+{
+        if (r < s->crow) {
+                csi_n(s->crow - r, 'A');
+        } else if (r > s->crow) {
+                while (s->crow < r) {
+                        el_putchar('\n');
+                        s->crow++;
+                }
+                el_putchar('\r');
+                c = 0;
+        }
+        s->crow = r;
+        move_cursor(to - c);
+}
+
+static void cursor_to(struct editline *s, uint8_t from, uint8_t to)
+{
+        uint8_t r = row_of(s, to);
+        goto_row(s, col_of(s, row_of(s, from), from), r, col_of(s, r, to));
+}
+
+/*
+ * print the command from 'from' to the end of row 'last' and put the cursor
+ * back at pos. The cursor is at column c of crow, which is where 'from' was
+ * before the layout changed.
+ */
+static void print_rows(struct editline *s, uint8_t from, uint8_t c, uint8_t last)
+{
+        const char *b = buf(s);
+        uint8_t r = row_of(s, from), e;
+        show_cursor(false);
+        goto_row(s, c, r, col_of(s, r, from));
+        for (;; r++) {
+                e = row_end(s, r);
+                /* newlines show as a space, only the last row of a command
+                 * with too many rows has one before its end */
+                for (uint8_t i = from; i < e && i - s->rowstart[r] < row_width(s, r); i++)
+                        el_putchar(b[i] == '\n' ? ' ' : b[i]);
+                if (r == last)
+                        break;
+                csi('K');
+                putchar2('\r', '\n');
+                from = e;
+        }
+        /* the command may have had more rows */
+        csi(r + 1 == nrows(s) ? 'J' : 'K');
+        s->crow = r;
+        c = col_of(s, r, e);
+        goto_row(s, c, row_of(s, s->pos), col_of(s, row_of(s, s->pos), s->pos));
+        show_cursor(true);
+}
+
+static void
+redraw_current_command(struct editline *state)
+{
+        STAT(state, redraws);
+        show_cursor(false);
+        if (state->crow)
+                csi_n(state->crow, 'A');
+        state->crow = 0;
+        el_putchar('\r');
+        show_prompt();
+        state->nrows = 1;
+        state->rowstart[0] = 0;
+        print_rows(state, 0, PROMPT_COLS, relayout(state, 0, state->len, 0));
+}
+
+/* from..end changed and the command grew by delta, the cursor is at from */
+static void repaint(struct editline *state, uint8_t from, uint8_t end, int delta)
+{
+        STAT(state, repaints);
+        uint8_t c = col_of(state, state->crow, from);
+        print_rows(state, from, c, relayout(state, from, end, delta));
+}
+
+/* n characters were inserted at the cursor, which moves past them */
+static void show_insert(struct editline *state, uint8_t n)
+{
+        state->pos += n;
+        repaint(state, state->pos - n, state->pos, n);
+}
+
+/* n characters were deleted at the cursor */
+static void show_delete(struct editline *state, uint8_t n)
+{
+        if (n)
+                repaint(state, state->pos, state->pos, -n);
+}
+
+/* n characters at the cursor changed */
+static void show_overwrite(struct editline *state, uint8_t n)
+{
+        if (n)
+                repaint(state, state->pos, state->pos + n, 0);
+}
+
+/* leave the command on screen and start a new one below it */
+static void show_newline(struct editline *state)
+{
+        cursor_to(state, state->pos, state->len);
+        putchar2('\r', '\n');
+        state->crow = 0;
+}
+
+static void hide_line(struct editline *state)
+{
+        if (state->crow)
+                csi_n(state->crow, 'A');
+        state->crow = 0;
+        el_putchar('\r');
+        csi('J');
+}
+
+/* the cursor is saved by the first begin until the end of the status lines */
+static void status_begin(struct editline *state, int n)
+{
+        show_cursor(false);
+        if (!state->status)
+                putchar2('\033', '7');
+        state->status = true;
+        csi_n(n + 1, 'H');
+        el_putchar('\r');
+}
+
+static void status_end(struct editline *state)
+{
+        csi('K');
+        putchar2('\033', '8');
+        state->status = false;
+        show_cursor(true);
+}
+
+void editline_set_columns(struct editline *s, uint8_t cols)
+{
+        COUNT_OUTPUT(s);
+        tx_barrier();
+        hide_line(s);
+        s->cols = cols > PROMPT_COLS + 2 ? cols : PROMPT_COLS + 2;
+        redraw_current_command(s);
+}
+#else
+#define cursor_to(s, from, to)  move_cursor((to) - (from))
+
 static void
 print_from(struct editline *state, bufptr_t pos)
 {
         show_cursor(false);
         bufptr_t cpos = pos;
         for (; state->buf[cpos]; cpos++)
-                user_putchar(state->buf[cpos]);
+                el_putchar(state->buf[cpos]);
         csi('K');
         move_cursor(- (cpos - pos));
         show_cursor(true);
@@ -90,13 +590,11 @@ print_from(struct editline *state, bufptr_t pos)
 static void
 redraw_current_command(struct editline *state)
 {
+        STAT(state, redraws);
+        tx_supersede();
         show_cursor(false);
-        user_putchar('\r');
-        if (EDITLINE_PROMPT) {
-                csi_n(92, 'm');
-                user_putchar(EDITLINE_PROMPT);
-                csi('m');
-        }
+        el_putchar('\r');
+        show_prompt();
         print_from(state, state->hcur);
         move_cursor(state->pos);
 }
@@ -106,12 +604,84 @@ static void
 print_rest(struct editline *state)
 {
         assert(!state->hcur);
+        STAT(state, repaints);
         print_from(state, state->pos);
 }
 
+/* n characters were inserted at the cursor, which moves past them */
+static void show_insert(struct editline *state, uint8_t n)
+{
+        while (n--)
+                el_putchar(state->buf[state->pos++]);
+        print_rest(state);
+}
+
+/* n characters were deleted at the cursor */
+static void show_delete(struct editline *state, uint8_t n)
+{
+        if (!n)
+                return;
+        if (state->buf[state->pos])
+                print_rest(state);
+        else
+                csi('K');
+}
+
+/* n characters at the cursor changed */
+#define show_overwrite(s, n)    print_rest(s)
+#define show_newline(s)         putchar2('\r', '\n')
+
+static void hide_line(struct editline *state)
+{
+        el_putchar('\r');
+        csi('K');
+}
+
+static void status_begin(struct editline *state, int n)
+{
+        show_cursor(false);
+        csi_n(n + 1, 'H');
+        el_putchar('\r');
+}
+
+static void status_end(struct editline *state)
+{
+        csi('K');
+        csi_n(999, 'H');
+        el_putchar('\r');
+        move_cursor(state->pos + 1);
+        show_cursor(true);
+}
+#endif
+
+#define show_history(s)         redraw_current_command(s)
+#define show_cleared(s)         redraw_current_command(s)
+#define show_realized(copy)
+#define show_committed(s, keep) redraw_current_command(s)
+#define restore_line(s)         redraw_current_command(s)
+#define clear_screen()          csi_n(2, 'J')
+
+static void status_reserve(int n)
+{
+#if ENABLE_MULTILINE
+        /* setting margins homes the cursor and the command need not be at
+         * the bottom */
+        putchar2('\033', '7');
+#endif
+        csi_n(n + 1, ';');
+        putchar2('9', '9');
+        putchar2('9', 'r');
+#if ENABLE_MULTILINE
+        putchar2('\033', '8');
+#endif
+}
+#endif
+
 void editline_redraw(struct editline *state)
 {
-        csi_n(2, 'J');
+        COUNT_OUTPUT(state);
+        tx_barrier();
+        clear_screen();
         redraw_current_command(state);
 }
 
@@ -182,37 +752,36 @@ char *editline_history(struct editline *s, int n)
 
 void editline_hide_command(struct editline *s)
 {
-        user_putchar('\r');
-        csi('K');
+        COUNT_OUTPUT(s);
+        tx_barrier();
+        hide_line(s);
 }
 void editline_restore_command(struct editline *s)
 {
-        redraw_current_command(s);
+        COUNT_OUTPUT(s);
+        restore_line(s);
 }
 
 /* should be called after redraw each time to ensure your status lines don't get
  * clobbered by scrolling */
 void reserve_statuslines(struct editline *state, int n)
 {
-        csi_n(n + 1, ';');
-        putchar2('9', '9');
-        putchar2('9', 'r');
+        COUNT_OUTPUT(state);
+        tx_barrier();
+        status_reserve(n);
 }
 
 void begin_statusline(struct editline *state, int n)
 {
-        show_cursor(false);
-        csi_n(n + 1, 'H');
-        user_putchar('\r');
+        COUNT_OUTPUT(state);
+        tx_barrier();
+        status_begin(state, n);
 }
 
 void end_statusline(struct editline *state)
 {
-        csi('K');
-        csi_n(999, 'H');
-        user_putchar('\r');
-        move_cursor(state->pos + 1);
-        show_cursor(true);
+        COUNT_OUTPUT(state);
+        status_end(state);
 }
 
 /* this translates terminal codes for special keys to
@@ -233,6 +802,7 @@ void end_statusline(struct editline *state)
  * */
 int editline_process_char(struct editline *s, char ch)
 {
+        COUNT_OUTPUT(s);
         if (!s->escape)  {
                 if (ch == CTL('[')) {
                         s->escape = 1;
@@ -257,13 +827,12 @@ int editline_process_char(struct editline *s, char ch)
                         s->escape = ch;
                         return EL_NOTHING;
                 }
-                /* unknown CSI sequence */
-                return EL_NOTHING;
-        } else if (s->escape >= '0' && s->escape <= '9') {
+        } else {
+                /* a single digit so far, or 3 once the sequence is unknown */
+                char key = s->escape;
+                s->escape = 0;
                 if (ch == '~') {
-                        ch = s->escape;
-                        s->escape = 0;
-                        switch (ch) {
+                        switch (key) {
                         case '1':
                                 return editline_char(s, CTL('A'));
                         case '3':
@@ -272,40 +841,76 @@ int editline_process_char(struct editline *s, char ch)
                                 return editline_char(s, CTL('E'));
                         }
                 }
-                /* unknown CSI sequence */
+        }
+        /* parameter and intermediate bytes run up to the final byte */
+        if (ch >= 0x20 && ch <= 0x3f) {
+                s->escape = 3;
                 return EL_NOTHING;
         }
+        /* unknown CSI sequence, anything but a final byte is taken as typed */
+        STAT(s, unknown_escapes);
+        if (ch < 0x40 || ch > 0x7e)
+                return editline_process_char(s, ch);
         return EL_NOTHING;
 }
 
+#if ENABLE_RXQUEUE
+_Static_assert(QUEUE_SIZE_OK(EDITLINE_RXQUEUE_SIZE),
+               "EDITLINE_RXQUEUE_SIZE must be a power of two, at most 128");
+
+int editline_process_queue(struct editline *s, struct editline_rxq *q)
+{
+        int ret = EL_NOTHING;
+        while (ret == EL_NOTHING && q->tail != q->head) {
+                uint8_t tail = q->tail;
+                char ch = q->buf[tail & (EDITLINE_RXQUEUE_SIZE - 1)];
+                q->tail = tail + 1;
+                ret = editline_process_char(s, ch);
+        }
+        if (q->throttled && editline_rxq_pending(q) <= EDITLINE_RXQUEUE_LOW) {
+                q->throttled = false;
+                if (q->throttle)
+                        q->throttle(false);
+        }
+        return ret;
+}
+#endif
+
 static void raw_insert(struct editline *s, int pos, int len)
 {
+        STAT_ADD(s, moved, EDITLINE_BUFSIZE - (pos + len));
         memmove(s->buf + pos + len, s->buf + pos, EDITLINE_BUFSIZE - (pos + len));
         memset(s->buf + pos, ' ', len);
 }
 
 static void raw_delete(struct editline *s, int pos, int len)
 {
+        STAT_ADD(s, moved, EDITLINE_BUFSIZE - (pos + len));
         memmove(s->buf + pos, s->buf + pos + len, EDITLINE_BUFSIZE - (pos + len));
-        memset(s->buf + EDITLINE_BUFSIZE - (pos + len), '\177', pos + len);
+        memset(s->buf + EDITLINE_BUFSIZE - len, '\177', len);
 }
 
 static void realize_history(struct editline *state, bool always_promote)
 {
         if (!state->hcur)
                 return;
+        STAT(state, promotions);
         int cl = strlen(state->buf) + 1;
         raw_delete(state, 0, cl);
         state->hcur -= cl;
-        if (!state->hcur && always_promote)
+        if (!state->hcur && always_promote) {
+                show_realized(false);
                 return;
+        }
         int hl = strlen(state->buf + state->hcur) + 1;
         if (always_promote || state->hcur + 2 * hl  >= EDITLINE_BUFSIZE) {
                 //memswap(state->buf, cl + 1, state->hcur - (cl + 1), hl + 1);
                 memswap(state->buf, 0, state->hcur, hl);
+                show_realized(false);
         } else {
                 raw_insert(state, 0, hl);
                 memcpy(state->buf, state->buf + state->hcur + hl, hl);
+                show_realized(true);
         }
         state->hcur = 0;
         assert(state->len == hl - 1);
@@ -330,11 +935,18 @@ static void delete_chars(struct editline *state, int pos, int len)
 }
 
 
+#if ENABLE_TOKENIZE
+/* room for the extension bytes editline_tokenize adds, one per 31 characters */
+#define TOKEN_ROOM      (EDITLINE_BUFSIZE / 31)
+#else
+#define TOKEN_ROOM      0
+#endif
+
 /* pads with spaces, pos may be greater than len */
 static bool insert_chars(struct editline *state, int pos, int len)
 {
         realize_history(state, false);
-        if (len + state->len >= EDITLINE_BUFSIZE - 1)
+        if (len + state->len >= EDITLINE_BUFSIZE - 1 - TOKEN_ROOM)
                 return false;
         raw_insert(state, pos, len);
         state->len += len;
@@ -347,7 +959,7 @@ static void move_cursor_to(struct editline *state, int pos)
                 pos = 0;
         if (pos > state->len)
                 pos = state->len;
-        move_cursor(pos - state->pos);
+        cursor_to(state, state->pos, pos);
         state->pos = pos;
 }
 
@@ -396,9 +1008,37 @@ clear_head(struct editline *state)
         state->len = state->pos = state->hcur = 0;
 }
 
+bool editline_insert(struct editline *state, const char *str, int len)
+{
+        COUNT_OUTPUT(state);
+        /* NUL ends the command and the high bit marks tokenizer codes */
+        for (int i = 0; i < len; i++)
+                if (!str[i] || ISMETA(str[i]))
+                        return false;
+        if (!insert_chars(state, state->pos, len))
+                return false;
+        memcpy(state->buf + state->pos, str, len);
+        show_insert(state, len);
+        return true;
+}
+
+#if ENABLE_MULTILINE
+/* the command ends in a backslash that is not itself escaped */
+static bool continued(struct editline *state)
+{
+        const char *b = buf(state);
+        int i = state->len;
+        while (i && b[i - 1] == '\\')
+                i--;
+        return (state->len - i) & 1 && state->nrows < EDITLINE_MAXROWS;
+}
+#endif
+
 static int
 editline_char(struct editline *state, char ch)
 {
+        tx_begin_run();
+        STAT(state, keys);
         state->key = ch;
         unsigned char npos = state->pos;
         switch (ch) {
@@ -411,9 +1051,9 @@ editline_char(struct editline *state, char ch)
                         return EL_NOTHING;
                 move_cursor_to(state, state->pos - 1);
         case CTL('D'):
-                if (state->buf[state->pos]) {
+                if (buf(state)[state->pos]) {
                         delete_chars(state, state->pos, 1);
-                        print_rest(state);
+                        show_delete(state, 1);
                 }
 //                print_from(state, state->pos);
                 break;
@@ -429,7 +1069,7 @@ editline_char(struct editline *state, char ch)
         case META('d'):
                 npos = search_eow(state, npos, true);
                 delete_chars(state, state->pos, npos - state->pos);
-                print_rest(state);
+                show_delete(state, npos - state->pos);
                 break;
         case META('u'):
         case META('c'):
@@ -449,7 +1089,7 @@ editline_char(struct editline *state, char ch)
                 else
                         for (; i < npos; i++)
                                 state->buf[i] = tolower(state->buf[i]);
-                print_rest(state);
+                show_overwrite(state, npos - state->pos);
                 move_cursor_to(state, npos);
                 break;
         case META('t'): {
@@ -466,7 +1106,8 @@ editline_char(struct editline *state, char ch)
                         break;
                 int lof = eof - bof, low = bos - eof, los = eos - bos;
                 memswap(state->buf + bof, lof, low, los);
-                redraw_current_command(state);
+                move_cursor_to(state, bof);
+                show_overwrite(state, eos - bof);
                 move_cursor_to(state, eos);
                 break;
         }
@@ -475,13 +1116,14 @@ editline_char(struct editline *state, char ch)
         case CTL('W'):
                 npos = search_bow(state, npos, true);
                 delete_chars(state, npos, state->pos - npos);
+                int n = state->pos - npos;
                 move_cursor_to(state, npos);
-                print_rest(state);
+                show_delete(state, n);
                 break;
 #endif
         case CTL('T'): {
                 realize_history(state, false);
-                if (!state->buf[npos])
+                if (!state->buf[npos] && npos)
                         npos--;
                 if (npos < 1)
                         break;
@@ -490,15 +1132,16 @@ editline_char(struct editline *state, char ch)
                 state->buf[npos] = state->buf[npos + 1];
                 state->buf[npos + 1] = tmp;
                 move_cursor_to(state, npos);
-                print_rest(state);
+                show_overwrite(state, 2);
                 move_cursor_to(state, npos + 2);
                 break;
         }
         case CTL('K'):
+                npos = state->len;
                 delete_chars(state, state->pos, state->len - state->pos);
                 assert(state->len == state->pos);
 //               state->len = state->pos;
-                csi('K');
+                show_delete(state, npos - state->pos);
                 break;
 #if ENABLE_HISTORY
         case CTL('P'):
@@ -506,12 +1149,13 @@ editline_char(struct editline *state, char ch)
                 state->hcur = nhistory(state, state->hcur, ch == CTL('P') ? 1 : -1);
                 state->len = strlen(buf(state));
                 state->pos = state->len;
-                redraw_current_command(state);
+                show_history(state);
                 break;
 #endif
 #if ENABLE_DEBUG
         case CTL('V'):
-                putchar2('\r', '\n');
+                tx_barrier();
+                show_newline(state);
                 csi_n(2, 'm');
                 putchar2('p', ':');
                 putnum(state->pos);
@@ -523,48 +1167,255 @@ editline_char(struct editline *state, char ch)
                 csi('m');
                 for (int i = 0; i < EDITLINE_BUFSIZE; i++)
                         debug_color_char(state->buf[i]);
+                COUNT_OUTPUT(state);
                 putchar2('\r', '\n');
                 redraw_current_command(state);
                 break;
 #endif
         case CTL('U'):
+                npos = state->pos;
                 delete_chars(state, 0, state->pos);
                 move_cursor_to(state, 0);
-                print_rest(state);
+                show_delete(state, npos);
                 break;
         case CTL('C'):
-                putchar2('\r', '\n');
+                tx_barrier();
+                show_newline(state);
         case CTL('Q'):
                 clear_head(state);
-                redraw_current_command(state);
+                show_cleared(state);
                 break;
-        case META('v'):;
-                char ins[] = "hello";
-                if (insert_chars(state, state->pos, sizeof(ins) - 1)) {
-                        memcpy(state->buf + state->pos, ins, sizeof(ins) - 1);
-                        print_rest(state);
-                        move_cursor_to(state, state->pos + sizeof(ins) - 1);
-                }
+        case META('v'):
+                editline_insert(state, "hello", 5);
                 break;
         case '\r':
         case '\n':
-                putchar2('\r', '\n');
+#if ENABLE_MULTILINE
+                if (continued(state)) {
+                        move_cursor_to(state, state->len);
+                        editline_insert(state, "\n", 1);
+                        break;
+                }
+#endif
+                tx_barrier();
+                show_newline(state);
                 realize_history(state, true);
                 return  EL_COMMAND;
         default:
                 if (ISMETA(ch) || ISCTL(ch))
                         return EL_UNKNOWN;
                 if (insert_chars(state, state->pos, 1))  {
-                        state->buf[state->pos++] = ch;
-                        user_putchar(ch);
-                        print_rest(state);
+                        state->buf[state->pos] = ch;
+                        show_insert(state, 1);
                 }
         }
         return EL_NOTHING;
 }
 
+#if ENABLE_TOKENIZE
+/*
+ * Tokenizing happens in place. Each quote or backslash removed from an
+ * argument is recorded in a code byte, the codes are stored after the
+ * argument's terminating NUL with the last one taking the place of the
+ * separating space. Codes have the high bit set, which a command never does,
+ * and hold the removed character along with how many characters were kept
+ * after it. The character is encoded relative to the quoting state following
+ * it so codes can be decoded backwards, leaving more room for the count
+ * inside quotes. A count that fills its bits is continued in extension bytes
+ * in front of the code, each adding up to 127 and a full one followed by
+ * another. There is no room for them in the argument so the rest of the
+ * buffer is moved up, which insert_chars leaves TOKEN_ROOM bytes for, and
+ * back down by untokenize.
+ *
+ * A backslash and newline continuing the command separate arguments. When
+ * they end one the backslash is removed like any other and the newline is
+ * taken as its separator, a backslash code with nothing kept after it, which
+ * an escape never leaves, tells untokenize to put the newline back.
+ */
+enum { Q_NONE, Q_DOUBLE, Q_SINGLE };
+
+static bool is_continuation(const char *b, int i)
+{
+        return b[i] == '\\' && b[i + 1] == '\n';
+}
+
+static uint8_t gap_bits(uint8_t q)
+{
+        return q == Q_NONE ? 5 : q == Q_DOUBLE ? 6 : 7;
+}
+
+/* q is the quoting state after ch */
+static char make_code(char ch, uint8_t q)
+{
+        uint8_t kind = ch == '\\' ? 0 : ch == '"' ? 1 : q == Q_SINGLE ? 0 : 2;
+        return META(kind << gap_bits(q));
+}
+
+/*
+ * count a kept character against the code at i which has ext extension bytes
+ * in front. Returns true if the count filled up and another extension byte
+ * was added, moving the code and everything after it up one.
+ */
+static bool count_kept(struct editline *s, int i, int ext, uint8_t q)
+{
+        char *c = s->buf + i - ext;
+        uint8_t full = ext ? 0x7f : (1 << gap_bits(q)) - 1;
+        if ((++*c & full) != full)
+                return false;
+        assert(s->len + 1 < EDITLINE_BUFSIZE);
+        raw_insert(s, i - ext, 1);
+        s->buf[i - ext] = META(0);
+        s->len++;
+        return true;
+}
+
+/*
+ * put back the removed characters whose n code and extension bytes
+ * immediately follow the content ending at z. q is the quoting state at the
+ * end. The text put back ends short of the codes by the number of extension
+ * bytes, which is returned.
+ */
+static int unsquash(char *z, int n, uint8_t q)
+{
+        char *ins = z, *end = z + n - 1;
+        int ext = 0;
+        for (; z <= end; z++) {
+                uint8_t b = gap_bits(q), code = UNMETA(*end);
+                int gap = code & ((1 << b) - 1);
+                if (gap == (1 << b) - 1) {
+                        char *e = end;
+                        uint8_t x;
+                        do {
+                                x = UNMETA(*--e);
+                                gap += x;
+                        } while (x == 0x7f);
+                        ext += end - e;
+                        *e = *end;
+                        end = e;
+                }
+                char ch = "\\\"'"[code >> b];
+                if (q == Q_SINGLE)
+                        ch = '\'';
+                ins -= gap;
+                memmove(ins + 1, ins, end - ins);
+                *ins = ch;
+                if (ch == '"')
+                        q = q == Q_DOUBLE ? Q_NONE : Q_DOUBLE;
+                else if (ch == '\'')
+                        q = q == Q_SINGLE ? Q_NONE : Q_SINGLE;
+        }
+        return ext;
+}
+
+/* unsquash the argument whose codes are [z,z+n) and close up after it */
+static void restore_arg(struct editline *s, int z, int n, uint8_t q)
+{
+        int ext = unsquash(s->buf + z, n, q);
+        if (ext) {
+                raw_delete(s, z + n - ext, ext);
+                s->len -= ext;
+        }
+}
+
+/* restore the command after editline_tokenize, a no-op otherwise. */
+static void untokenize(struct editline *s)
+{
+        char *b = s->buf;
+        if (!s->tokenized)
+                return;
+        s->tokenized = false;
+        for (int j = s->len; j >= 0; j--) {
+                if (ISMETA(b[j])) {
+                        int z = j;
+                        while (ISMETA(b[z - 1]))
+                                z--;
+                        z--;
+                        memmove(b + z, b + z + 1, j - z);
+                        b[j] = j == s->len ? 0 : b[j] == META(0) ? '\n' : ' ';
+                        restore_arg(s, z, j - z, Q_NONE);
+                        j = z;
+                } else if (!b[j] && j < s->len)
+                        b[j] = ' ';
+        }
+}
+
+int editline_tokenize(struct editline *s, char **argv, int max)
+{
+        char *b = s->buf;
+        int argc = 0, rd = 0;
+        assert(!s->hcur);
+        untokenize(s);
+        s->tokenized = true;
+        for (;;) {
+                while (rd < s->len && (b[rd] == ' ' || is_continuation(b, rd)))
+                        rd += b[rd] == ' ' ? 1 : 2;
+                if (rd >= s->len)
+                        return argc;
+                if (argc == max) {
+                        untokenize(s);
+                        return -2;
+                }
+                /*
+                 * content so far is [start,wc), followed by n code and
+                 * extension bytes. The last code has ext of them.
+                 */
+                int start = rd, wc = rd, n = 0, ext = 0;
+                uint8_t q = Q_NONE;
+                bool lit = false;
+                for (; rd < s->len && (q || lit || b[rd] != ' '); rd++) {
+                        char ch = b[rd];
+                        bool drop = true;
+                        if (!q && !lit && is_continuation(b, rd)) {
+                                b[rd++] = make_code(ch, q);
+                                n++;
+                                break;
+                        }
+                        if (lit)
+                                lit = drop = false;
+                        else if (q != Q_SINGLE && ch == '\\' && rd + 1 < s->len
+                                 && (q == Q_NONE || b[rd + 1] == '"' || b[rd + 1] == '\\'))
+                                lit = true;
+                        else if (q != Q_SINGLE && ch == '"')
+                                q = q ? Q_NONE : Q_DOUBLE;
+                        else if (q != Q_DOUBLE && ch == '\'')
+                                q = q ? Q_NONE : Q_SINGLE;
+                        else
+                                drop = false;
+                        if (drop) {
+                                b[rd] = make_code(ch, q);
+                                n++;
+                                ext = 0;
+                                continue;
+                        }
+                        if (n) {
+                                memmove(b + wc + 1, b + wc, n);
+                                if (count_kept(s, rd, ext, q)) {
+                                        n++;
+                                        ext++;
+                                        rd++;
+                                }
+                        }
+                        b[wc++] = ch;
+                }
+                if (q) {
+                        restore_arg(s, wc, n, q);
+                        untokenize(s);
+                        return -1;
+                }
+                memmove(b + wc + 1, b + wc, n);
+                b[wc] = 0;
+                argv[argc++] = b + start;
+                rd++;
+        }
+}
+#else
+#define untokenize(s)
+#endif
+
 void editline_command_complete(struct editline *state, bool add_to_history)
 {
+        COUNT_OUTPUT(state);
+        untokenize(state);
         if (!add_to_history)
                 clear_head(state);
         if (state->buf[0]) {
@@ -573,12 +1424,14 @@ void editline_command_complete(struct editline *state, bool add_to_history)
                 state->pos = state->len = 0;
         }
         assert(!state->hcur);
-        redraw_current_command(state);
+        show_committed(state, add_to_history);
 }
 
 void
 debug_color_char(char c)
 {
+        COUNT_OUTPUT(NULL);
+        tx_barrier();
         if (ISMETA(c)) {
                 csi_n(7, 'm');
                 c = UNMETA(c);
@@ -587,7 +1440,7 @@ debug_color_char(char c)
                 csi_n(94, 'm');
                 c ^= 64;
         }
-        user_putchar(c);
+        el_putchar(c);
         csi('m');
 }
 
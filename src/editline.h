@@ -13,10 +13,51 @@
 #define EDITLINE_PROMPT  ';'
 #endif
 
+#ifndef EDITLINE_RXQUEUE_SIZE
+#define EDITLINE_RXQUEUE_SIZE 32  /* power of two, at most 128 */
+#endif
+#ifndef EDITLINE_TXQUEUE_SIZE
+#define EDITLINE_TXQUEUE_SIZE 64  /* power of two, at most 128 */
+#endif
+#ifndef EDITLINE_COLUMNS
+#define EDITLINE_COLUMNS 80       /* terminal width until editline_set_columns */
+#endif
+#ifndef EDITLINE_MAXROWS
+#define EDITLINE_MAXROWS 8        /* rows a multiline command may take */
+#endif
+
 /* enable features that may affect code size */
+#ifndef ENABLE_WORDS
 #define ENABLE_WORDS   true   /* all word editing commands */
+#endif
+#ifndef ENABLE_HISTORY
 #define ENABLE_HISTORY true   /* history, ctrl-[pn] */
+#endif
+#ifndef ENABLE_DEBUG
 #define ENABLE_DEBUG   false  /* debug key & assertions. needs stdio. big!*/
+#endif
+#ifndef ENABLE_RXQUEUE
+#define ENABLE_RXQUEUE true   /* interrupt safe input queue */
+#endif
+#ifndef ENABLE_TOKENIZE
+#define ENABLE_TOKENIZE true  /* editline_tokenize */
+#endif
+#ifndef ENABLE_TXQUEUE
+#define ENABLE_TXQUEUE false  /* queue output rather than call user_putchar */
+#endif
+#ifndef ENABLE_BINARY
+#define ENABLE_BINARY  false  /* binary protocol output, see editline_binary.h */
+#endif
+#ifndef ENABLE_STATS
+#define ENABLE_STATS   false  /* per instance counters, editline_get_stats */
+#endif
+#ifndef ENABLE_MULTILINE
+#define ENABLE_MULTILINE false /* wrap long commands, continue with backslash */
+#endif
+
+#if ENABLE_MULTILINE && ENABLE_BINARY
+#error "ENABLE_MULTILINE draws with VT100 codes, the binary decoder lays out a single line"
+#endif
 
 /* META-k can be typed as ALT-k or ESC k */
 #define CTL(x)          (char)((x) & 0x1F)
@@ -34,23 +75,134 @@ enum {
         EL_UNKNOWN      // unknown control or alt code, value stored in key.
 };
 
+#if ENABLE_STATS
+// counters kept for each instance. They wrap around rather than saturate so
+// take differences between snapshots.
+struct editline_stats {
+        uint32_t keys;          // keys acted on after escape decoding
+        uint32_t bytes_out;     // characters written to the terminal
+        uint32_t redraws;       // full redraws of the command line
+        uint32_t repaints;      // partial repaints from the cursor onwards
+        uint32_t moved;         // bytes memmoved inserting and deleting
+        uint32_t promotions;    // history entries made the current command
+        uint32_t unknown_escapes; // escape sequences dropped as unknown
+};
+#endif
+
 struct editline {
         // key decoding
         char escape, key;
         // buffer
         uint8_t pos, len, hcur;
         char buf[EDITLINE_BUFSIZE];
+#if ENABLE_STATS
+        struct editline_stats stats;
+#endif
+#if ENABLE_TOKENIZE
+        // editline_tokenize left codes in buf that must be undone
+        bool tokenized;
+#endif
+#if ENABLE_MULTILINE
+        // layout, row r of the command starts at rowstart[r] and the cursor
+        // is on row crow.
+        uint8_t cols, nrows, crow;
+        uint8_t rowstart[EDITLINE_MAXROWS];
+        // begin_statusline saved the cursor, end_statusline restores it.
+        bool status;
+#endif
 };
 
 #define EDITLINE_INIT {  0 }
 
+#if ENABLE_RXQUEUE
+/* queue fill levels at which the throttle hook is called */
+#define EDITLINE_RXQUEUE_HIGH   (EDITLINE_RXQUEUE_SIZE * 3 / 4)
+#define EDITLINE_RXQUEUE_LOW    (EDITLINE_RXQUEUE_SIZE / 4)
+
+// Lock free single producer, single consumer input queue. Characters are
+// pushed with editline_rxq_push, typically from a receive interrupt, and the
+// main loop processes them with editline_process_queue.
+//
+// throttle is optional, if set it is called with true when the queue fills
+// past EDITLINE_RXQUEUE_HIGH and with false once it has drained to
+// EDITLINE_RXQUEUE_LOW, so you may drive RTS or send XOFF/XON. Note the call
+// to stop happens in the context of editline_rxq_push.
+struct editline_rxq {
+        volatile uint8_t head, tail;
+        volatile uint8_t overflow;      // characters dropped, saturates at 255
+        volatile bool throttled;
+        void (*throttle)(bool stop);
+        volatile char buf[EDITLINE_RXQUEUE_SIZE];
+};
+
+#define EDITLINE_RXQ_INIT { 0 }
+
+// number of characters waiting in the queue.
+static inline uint8_t editline_rxq_pending(const struct editline_rxq *q)
+{
+        return (uint8_t)(q->head - q->tail);
+}
+
+// constant time, safe to call from an interrupt. drops the character and
+// counts an overflow if the queue is full.
+static inline void editline_rxq_push(struct editline_rxq *q, char ch)
+{
+        uint8_t head = q->head, fill = head - q->tail;
+        if (fill >= EDITLINE_RXQUEUE_SIZE) {
+                if (q->overflow != 255)
+                        q->overflow++;
+                return;
+        }
+        q->buf[head & (EDITLINE_RXQUEUE_SIZE - 1)] = ch;
+        q->head = head + 1;
+        if (fill + 1 >= EDITLINE_RXQUEUE_HIGH && !q->throttled && q->throttle) {
+                q->throttled = true;
+                q->throttle(true);
+        }
+}
+#endif
+
 
 // These should be implemented by the user of the library.
+#if !ENABLE_TXQUEUE
 void user_putchar(char ch);
+#else
+// called after each character is queued and repeatedly while the output queue
+// is full. It should make sure editline_tx_drain is being called, for instance
+// by enabling the transmit interrupt, or drain the queue itself.
+void user_tx_kick(void);
+
+// take up to max characters from the output queue, returns how many were
+// copied. Safe to call from an interrupt such as UDRE or DMA completion.
+int editline_tx_drain(char *dst, int max);
+
+// number of characters waiting in the output queue.
+uint8_t editline_tx_pending(void);
+
+#endif
+
+// output a character of your own. With ENABLE_TXQUEUE use this rather than
+// writing to the device directly so it is ordered correctly with editline
+// output, otherwise it just calls user_putchar. With ENABLE_BINARY it escapes
+// characters with the high bit set, which would otherwise be taken for
+// operations.
+void editline_putchar(char ch);
 
 // call this for each character typed and take action based on the return value.
 int editline_process_char(struct editline *s, char ch);
 
+#if ENABLE_RXQUEUE
+// process queued characters until the queue is empty or something other than
+// EL_NOTHING is returned, in which case it is returned and the rest of the
+// queue is left for the next call once you have acted on it.
+int editline_process_queue(struct editline *s, struct editline_rxq *q);
+#endif
+
+// insert text at the cursor as if it were typed, returns false if it does not
+// fit or holds a NUL or a byte with the high bit set, which a command cannot.
+// Useful for implementing completion on EL_UNKNOWN.
+bool editline_insert(struct editline *state, const char *str, int len);
+
 // these can be used to hide and restore the current command, so that you may
 // write to the screen without interfering.
 void editline_hide_command(struct editline *s);
@@ -68,10 +220,47 @@ void editline_redraw(struct editline *state);
 //
 // if reserve_statuslines is not called then the lines will be clobbered when
 // the terminal scrolls.
+//
+// Call begin_statusline before writing each line and end_statusline once after
+// the last to put the cursor back on the command.
 void reserve_statuslines(struct editline *state, int n);
 void begin_statusline(struct editline *state, int n);
 void end_statusline(struct editline *state);
 
+#if ENABLE_MULTILINE
+// set the terminal width and redraw the command laid out for it, such as when
+// the window was resized. Until then EDITLINE_COLUMNS is assumed.
+//
+// Commands longer than a row wrap onto the next, the last column is never
+// written so terminals that wrap on their own don't scroll behind our back.
+// Return on a command ending in a backslash starts a new row rather than
+// returning EL_COMMAND. Rows past EDITLINE_MAXROWS are not shown.
+void editline_set_columns(struct editline *s, uint8_t cols);
+#endif
+
+#if ENABLE_TOKENIZE
+// split the command in place after an EL_COMMAND into at most max arguments
+// pointing into the buffer, returns how many there are. Arguments are separated
+// by spaces and may be quoted with '' or "" or have characters escaped with a
+// backslash. Outside quotes a backslash continuing the command on a new row
+// separates arguments like a space. Returns -1 on an unterminated quote and -2
+// when there are more than max arguments, leaving the command as it was.
+//
+// Long arguments may need a few bytes past the command, so with this enabled,
+// which it is by default, commands are limited to EDITLINE_BUFSIZE / 31 bytes
+// less than they would be and the oldest history entry can lose its end. The
+// buffer is restored when editline_command_complete is called so history sees
+// the command as typed, or when editline_tokenize is called again.
+int editline_tokenize(struct editline *s, char **argv, int max);
+#endif
+
+#if ENABLE_STATS
+// copy the counters of s to out, then zero them if reset is true. Output is
+// counted against the instance passed to the last call that produced any, so
+// editline_putchar and debug_color_char are not counted.
+void editline_get_stats(struct editline *s, struct editline_stats *out, bool reset);
+#endif
+
 // call this after an EL_COMMAND was returned once you are done processing it.
 void editline_command_complete(struct editline *state, bool add_to_history);
 
@@ -0,0 +1,54 @@
+#ifndef EDITLINE_BINARY_H
+#define EDITLINE_BINARY_H
+
+// Binary line state protocol, sent instead of VT100 output with
+// ENABLE_BINARY. Rather than drawing the line the device describes each
+// change to it and a host side decoder such as tools/el_decode.c keeps a copy
+// of the line and its history and renders them. Typing a character costs two
+// bytes however long the line is, recalling history costs one.
+//
+// Bytes below 0x80 are output to pass through as is, such as your command
+// output or status line text. Bytes with the high bit set are operations
+//
+//      1ooonnnn
+//
+// with op o and argument n, when n is 15 the argument is in the next byte.
+// Positions count characters from the start of the line, the cursor is where
+// the next character would be typed.
+//
+// The host keeps history as a list of lines, entry 0 being the one edited.
+// Editing a line recalled from history replaces entry 0 with it, see
+// EL_CTL_MOVE and EL_CTL_COPY, so the lists on both sides stay in step.
+
+enum {
+        EL_OP_INS,      // insert the next n bytes at the cursor and move past them
+        EL_OP_DEL,      // delete n characters at the cursor
+        EL_OP_LEFT,     // move the cursor n left
+        EL_OP_RIGHT,    // move the cursor n right
+        EL_OP_OVR,      // overwrite with the next n bytes, the cursor stays
+        EL_OP_HIST,     // show history entry n with the cursor at its end
+        EL_OP_CUR,      // move the cursor to n
+        EL_OP_CTL       // n is one of EL_CTL_*
+};
+
+enum {
+        EL_CTL_NEWLINE, // leave the line on screen and start a new one, the line is hidden
+        EL_CTL_KEEP,    // command done, push a new empty entry 0 unless it is empty, show it
+        EL_CTL_DROP,    // command done, empty entry 0 and show it
+        EL_CTL_CLEAR,   // empty entry 0 and show it
+        EL_CTL_HIDE,    // erase the line from the screen, output follows
+        EL_CTL_SHOW,    // draw the line again
+        EL_CTL_SCREEN,  // clear the screen
+        EL_CTL_LINE,    // followed by entry, length, text and cursor, replace that entry and show it
+        EL_CTL_MOVE,    // drop entry 0 then move the entry shown, now one less, to 0
+        EL_CTL_COPY,    // drop entry 0 then copy the entry shown, now one less, to 0
+        EL_CTL_RESERVE, // followed by n, keep the top n rows for status lines
+        EL_CTL_STATUS,  // followed by n, output goes to status line n
+        EL_CTL_STATUS_END, // back to the line after a status line
+        EL_CTL_LIT      // output the next byte, used for bytes with the high bit set
+};
+
+#define EL_OP(op, n)    (char)(0x80 | (op) << 4 | (n))
+#define EL_OP_EXT       15      // argument follows
+
+#endif
@@ -0,0 +1,166 @@
+#include "editline_commands.h"
+
+#include <string.h>
+
+#ifdef __AVR__
+#define flash_byte(p)   pgm_read_byte(p)
+#define flash_word(p)   pgm_read_word(p)
+#define flash_copy      memcpy_P
+#else
+#define flash_byte(p)   (*(const uint8_t *)(p))
+#define flash_word(p)   (*(p))
+#define flash_copy      memcpy
+#endif
+
+/* must match name_hash() in tools/mkcommands.py */
+static uint16_t name_hash(uint16_t seed, const char *s)
+{
+        uint16_t h = seed ^ 0x9dc5;
+        while (*s)
+                h = (h ^ (uint8_t)*s++) * 403;
+        return h ^ h >> 8;
+}
+
+static void get_cmd(const struct editline_cmdtab *t, int i, struct editline_command *c)
+{
+        flash_copy(c, &t->cmd[i], sizeof(*c));
+}
+
+/* length of the common prefix of s and the flash string f, up to len */
+static int common_prefix(const char *s, const char *f, int len)
+{
+        int i = 0;
+        while (i < len && s[i] && s[i] == (char)flash_byte(f + i))
+                i++;
+        return i;
+}
+
+static int flash_len(const char *f)
+{
+        int i = 0;
+        while (flash_byte(f + i))
+                i++;
+        return i;
+}
+
+static void put_flash(const char *f)
+{
+        for (char c; (c = flash_byte(f)); f++)
+                editline_putchar(c);
+}
+
+int editline_lookup(const struct editline_cmdtab *t, const char *name)
+{
+        if (!t->n)
+                return -1;
+        uint16_t d = flash_word(&t->disp[name_hash(0, name) % t->nbuckets]);
+        int i = flash_word(&t->slot[name_hash(d, name) % t->n]);
+        struct editline_command c;
+        get_cmd(t, i, &c);
+        int len = strlen(name);
+        if (common_prefix(name, c.name, len + 1) != len || flash_byte(c.name + len))
+                return -1;
+        return i;
+}
+
+#if ENABLE_TOKENIZE
+int editline_dispatch(struct editline *s, const struct editline_cmdtab *t)
+{
+        char *argv[EDITLINE_MAXARGS];
+        int argc = editline_tokenize(s, argv, EDITLINE_MAXARGS);
+        if (argc < 0)
+                return argc == -2 ? EL_CMD_TOOMANY : EL_CMD_SYNTAX;
+        if (!argc)
+                return 0;
+        int i = editline_lookup(t, argv[0]);
+        if (i < 0)
+                return EL_CMD_UNKNOWN;
+        struct editline_command c;
+        get_cmd(t, i, &c);
+        return c.handler(argc, argv);
+}
+#endif
+
+bool editline_complete_command(struct editline *s, const struct editline_cmdtab *t)
+{
+        const char *b = s->buf + s->hcur;
+        int start = 0;
+        while (b[start] == ' ')
+                start++;
+        if (start > s->pos || memchr(b + start, ' ', s->pos - start))
+                return false;
+        const char *prefix = b + start;
+        int plen = s->pos - start, first = -1, count = 0, common = 0;
+        struct editline_command c, f;
+        for (int i = 0; i < t->n; i++) {
+                get_cmd(t, i, &c);
+                if (common_prefix(prefix, c.name, plen) != plen)
+                        continue;
+                if (first < 0) {
+                        first = i;
+                        f = c;
+                        common = flash_len(c.name);
+                } else {
+                        /* compare the candidates in flash a byte at a time */
+                        int j = plen;
+                        while (j < common && flash_byte(c.name + j) == flash_byte(f.name + j))
+                                j++;
+                        common = j;
+                }
+                count++;
+        }
+        if (!count)
+                return true;
+        if (common > plen || count == 1) {
+                /* add what the candidates share, and a space if there is just one */
+                char add[16];
+                int n = 0;
+                for (int j = plen; j < common; j++) {
+                        add[n++] = flash_byte(f.name + j);
+                        if (n == sizeof(add)) {
+                                editline_insert(s, add, n);
+                                n = 0;
+                        }
+                }
+                if (count == 1 && s->buf[s->hcur + s->pos] != ' ')
+                        add[n++] = ' ';
+                if (n)
+                        editline_insert(s, add, n);
+                return true;
+        }
+        editline_hide_command(s);
+        for (int i = first; count; i++) {
+                get_cmd(t, i, &c);
+                if (common_prefix(prefix, c.name, plen) != plen)
+                        continue;
+                put_flash(c.name);
+                editline_putchar(' ');
+                editline_putchar(' ');
+                count--;
+        }
+        editline_putchar('\r');
+        editline_putchar('\n');
+        editline_restore_command(s);
+        return true;
+}
+
+void editline_help(const struct editline_cmdtab *t)
+{
+        struct editline_command c;
+        int width = 0;
+        for (int i = 0; i < t->n; i++) {
+                get_cmd(t, i, &c);
+                int len = flash_len(c.name);
+                if (len > width)
+                        width = len;
+        }
+        for (int i = 0; i < t->n; i++) {
+                get_cmd(t, i, &c);
+                put_flash(c.name);
+                for (int j = flash_len(c.name); j < width + 2; j++)
+                        editline_putchar(' ');
+                put_flash(c.help);
+                editline_putchar('\r');
+                editline_putchar('\n');
+        }
+}
@@ -0,0 +1,68 @@
+#ifndef EDITLINE_COMMANDS_H
+#define EDITLINE_COMMANDS_H
+
+#include "editline.h"
+
+// Command registry. Commands are listed in a definitions file, one
+//
+//      EDITLINE_COMMAND(handler, "name", "help text")
+//
+// per line, and tools/mkcommands.py turns it into a C file holding the table
+// along with a minimal perfect hash so looking up a name costs two passes
+// over it and a single compare no matter how many commands there are. The
+// table lives in flash on AVR.
+//
+// Including the definitions file after this header declares the handlers.
+
+#ifndef EDITLINE_MAXARGS
+#define EDITLINE_MAXARGS 8
+#endif
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define EL_FLASH PROGMEM
+#else
+#define EL_FLASH
+#endif
+
+#define EDITLINE_COMMAND(handler, name, help) int handler(int argc, char **argv);
+
+struct editline_command {
+        const char *name;
+        int (*handler)(int argc, char **argv);
+        const char *help;
+};
+
+// generated, cmd is sorted by name and slot maps a hash value to an index in
+// cmd. disp holds the displacement for each bucket.
+struct editline_cmdtab {
+        const struct editline_command *cmd;
+        const uint16_t *slot, *disp;
+        uint16_t n, nbuckets;
+};
+
+// returned by editline_dispatch, handlers should return values >= 0.
+enum {
+        EL_CMD_SYNTAX = -1,     // could not tokenize the command
+        EL_CMD_UNKNOWN = -2,    // no such command
+        EL_CMD_TOOMANY = -3     // more than EDITLINE_MAXARGS arguments
+};
+
+// index of the command called name in t->cmd or -1.
+int editline_lookup(const struct editline_cmdtab *t, const char *name);
+
+// call this after an EL_COMMAND, it tokenizes the command and calls the
+// handler returning its result. An empty command returns 0. You still need to
+// call editline_command_complete afterwards.
+int editline_dispatch(struct editline *s, const struct editline_cmdtab *t);
+
+// complete the command name under the cursor, call it on EL_UNKNOWN when key
+// is ^I (tab). If the name is ambiguous it is extended as far as possible,
+// if there is nothing to add the candidates are listed. Returns false if the
+// cursor is not within the first word.
+bool editline_complete_command(struct editline *s, const struct editline_cmdtab *t);
+
+// print each command with its help text.
+void editline_help(const struct editline_cmdtab *t);
+
+#endif
@@ -0,0 +1,376 @@
+#ifdef __linux__
+#define _GNU_SOURCE 1
+
+#include "editline_telnet.h"
+
+/* needs user_putchar for itself, see editline_telnet.h */
+#if !ENABLE_TXQUEUE
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/* telnet commands and options */
+#define SE      240
+#define SB      250
+#define WILL    251
+#define WONT    252
+#define DO      253
+#define DONT    254
+#define IAC     255
+
+#define OPT_ECHO  1
+#define OPT_SGA   3
+#define OPT_NAWS  31
+
+enum { T_DATA, T_IAC, T_OPT, T_SB, T_SBIAC };
+
+static int epfd = -1;
+static bool stop;
+static editline_telnet_fn *callback;
+static struct editline_session *sessions, *current;
+
+struct editline_session *editline_telnet_current(void)
+{
+        return current;
+}
+
+struct editline_session *editline_telnet_sessions(void)
+{
+        return sessions;
+}
+
+void editline_telnet_stop(void)
+{
+        stop = true;
+}
+
+static void set_pollout(struct editline_session *s, bool on)
+{
+        if (s->pollout == on)
+                return;
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | (on ? EPOLLOUT : 0),
+                                  .data.ptr = s };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->pollout = on;
+}
+
+/* write as much pending output as the socket will take */
+static void flush(struct editline_session *s)
+{
+        int off = 0;
+        while (off < s->olen) {
+                int n = write(s->fd, s->obuf + off, s->olen - off);
+                if (n > 0)
+                        off += n;
+                else if (n < 0 && errno == EINTR)
+                        continue;
+                else if (n < 0 && errno == EAGAIN)
+                        break;
+                else {
+                        /* connection is gone, drop the output */
+                        s->dead = true;
+                        off = s->olen;
+                }
+        }
+        memmove(s->obuf, s->obuf + off, s->olen - off);
+        s->olen -= off;
+        set_pollout(s, s->olen);
+}
+
+static void out_raw(struct editline_session *s, char ch)
+{
+        if (s->olen == sizeof(s->obuf))
+                flush(s);
+        if (s->olen == sizeof(s->obuf)) {
+                /* client is not reading, give up on it */
+                s->olen = 0;
+                s->dead = true;
+        }
+        if (!s->dead)
+                s->obuf[s->olen++] = ch;
+}
+
+static void out(struct editline_session *s, char ch)
+{
+        if ((uint8_t)ch == IAC)
+                out_raw(s, IAC);
+        out_raw(s, ch);
+}
+
+static void out_cmd(struct editline_session *s, uint8_t verb, uint8_t opt)
+{
+        out_raw(s, IAC);
+        out_raw(s, verb);
+        out_raw(s, opt);
+}
+
+/* a closing session gets no more prompts, say from editline_command_complete */
+void user_putchar(char ch)
+{
+        if (current && !current->closing)
+                out(current, ch);
+}
+
+void editline_telnet_write(struct editline_session *s, const char *buf, int len)
+{
+        for (int i = 0; i < len; i++) {
+                if (buf[i] == '\n')
+                        out(s, '\r');
+                out(s, buf[i]);
+        }
+}
+
+int editline_telnet_printf(struct editline_session *s, const char *fmt, ...)
+{
+        char buf[256], *p = buf;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n >= (int)sizeof(buf)) {
+                if ((p = malloc(n + 1))) {
+                        va_start(ap, fmt);
+                        vsnprintf(p, n + 1, fmt, ap);
+                        va_end(ap);
+                } else {
+                        p = buf;
+                        n = sizeof(buf) - 1;
+                }
+        }
+        if (n > 0)
+                editline_telnet_write(s, p, n);
+        if (p != buf)
+                free(p);
+        return n;
+}
+
+void editline_telnet_message(struct editline_session *s, const char *msg)
+{
+        struct editline_session *was = current;
+        current = s;
+        editline_hide_command(&s->el);
+        editline_telnet_write(s, msg, strlen(msg));
+        editline_restore_command(&s->el);
+        current = was;
+        if (s != was)
+                flush(s);
+}
+
+void editline_telnet_close(struct editline_session *s)
+{
+        s->closing = true;
+        /* wake up sessions other than the one being served so they get freed */
+        if (s != current)
+                shutdown(s->fd, SHUT_RD);
+}
+
+/* we offered ECHO and SGA and asked for NAWS, refuse anything else */
+static void negotiate(struct editline_session *s, uint8_t verb, uint8_t opt)
+{
+        if (verb == DO && opt != OPT_ECHO && opt != OPT_SGA)
+                out_cmd(s, WONT, opt);
+        else if (verb == WILL && opt != OPT_NAWS && opt != OPT_SGA)
+                out_cmd(s, DONT, opt);
+}
+
+static void subnegotiation(struct editline_session *s)
+{
+        if (s->sblen == 5 && s->sb[0] == OPT_NAWS) {
+                s->width = s->sb[1] << 8 | s->sb[2];
+                s->height = s->sb[3] << 8 | s->sb[4];
+#if ENABLE_MULTILINE
+                if (s->width)
+                        editline_set_columns(&s->el, s->width < 255 ? s->width : 255);
+#endif
+                callback(s, EL_RESIZE);
+        }
+}
+
+static void input(struct editline_session *s, uint8_t c)
+{
+        switch (s->tstate) {
+        case T_DATA:
+                if (c == IAC) {
+                        s->tstate = T_IAC;
+                        return;
+                }
+data:
+                /* enter arrives as CR LF or CR NUL */
+                if (s->cr && (c == '\n' || !c)) {
+                        s->cr = false;
+                        return;
+                }
+                s->cr = c == '\r';
+                int ev = editline_process_char(&s->el, c);
+                if (ev != EL_NOTHING)
+                        callback(s, ev);
+                return;
+        case T_IAC:
+                s->tstate = T_DATA;
+                if (c == IAC)
+                        goto data;
+                if (c >= WILL && c <= DONT) {
+                        s->verb = c;
+                        s->tstate = T_OPT;
+                } else if (c == SB) {
+                        s->sblen = 0;
+                        s->tstate = T_SB;
+                }
+                return;
+        case T_OPT:
+                s->tstate = T_DATA;
+                negotiate(s, s->verb, c);
+                return;
+        case T_SB:
+                if (c == IAC)
+                        s->tstate = T_SBIAC;
+                else if (s->sblen < sizeof(s->sb))
+                        s->sb[s->sblen++] = c;
+                return;
+        case T_SBIAC:
+                s->tstate = T_SB;
+                if (c == SE) {
+                        s->tstate = T_DATA;
+                        subnegotiation(s);
+                } else if (s->sblen < sizeof(s->sb)) {
+                        /* IAC IAC is a data byte */
+                        s->sb[s->sblen++] = c;
+                }
+                return;
+        }
+}
+
+static void session_free(struct editline_session *s)
+{
+        current = s;
+        callback(s, EL_DISCONNECT);
+        current = NULL;
+        epoll_ctl(epfd, EPOLL_CTL_DEL, s->fd, NULL);
+        close(s->fd);
+        if (s->prev)
+                s->prev->next = s->next;
+        else
+                sessions = s->next;
+        if (s->next)
+                s->next->prev = s->prev;
+        free(s);
+}
+
+/* send what was produced while serving s */
+static void session_done(struct editline_session *s)
+{
+        current = NULL;
+        flush(s);
+        if ((s->closing && !s->olen) || s->dead)
+                session_free(s);
+}
+
+static void session_open(int fd)
+{
+        struct editline_session *s = calloc(1, sizeof(*s));
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = s };
+        int one = 1;
+        if (!s || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                free(s);
+                close(fd);
+                return;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        s->fd = fd;
+        s->next = sessions;
+        if (sessions)
+                sessions->prev = s;
+        sessions = s;
+        current = s;
+        out_cmd(s, WILL, OPT_ECHO);
+        out_cmd(s, WILL, OPT_SGA);
+        out_cmd(s, DO, OPT_NAWS);
+        callback(s, EL_CONNECT);
+        int ret = editline_process_char(&s->el, CTL('L'));
+        if (ret != EL_NOTHING)
+                callback(s, ret);
+        session_done(s);
+}
+
+static void session_event(struct editline_session *s, uint32_t events)
+{
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                char buf[512];
+                int n = read(s->fd, buf, sizeof(buf));
+                if (n <= 0 && !(n < 0 && (errno == EAGAIN || errno == EINTR))) {
+                        session_free(s);
+                        return;
+                }
+                current = s;
+                for (int i = 0; i < n && !s->closing && !s->dead; i++)
+                        input(s, buf[i]);
+        }
+        session_done(s);
+}
+
+int editline_telnet_listen(const char *addr, int port)
+{
+        struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(port) };
+        int one = 1;
+        sa.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (addr && inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+                errno = EINVAL;
+                return -1;
+        }
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+                return -1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, SOMAXCONN) < 0) {
+                int e = errno;
+                close(fd);
+                errno = e;
+                return -1;
+        }
+        return fd;
+}
+
+int editline_telnet_serve(int listen_fd, editline_telnet_fn *fn)
+{
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL }, evs[64];
+        int ret = 0;
+        callback = fn;
+        stop = false;
+        if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+                return -1;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+                ret = -1;
+        while (!ret && !stop) {
+                int n = epoll_wait(epfd, evs, 64, -1);
+                if (n < 0 && errno != EINTR)
+                        ret = -1;
+                for (int i = 0; i < n; i++) {
+                        if (evs[i].data.ptr) {
+                                session_event(evs[i].data.ptr, evs[i].events);
+                                continue;
+                        }
+                        int fd;
+                        while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                                session_open(fd);
+                }
+        }
+        int e = errno;
+        while (sessions)
+                session_free(sessions);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, listen_fd, NULL);
+        close(epfd);
+        epfd = -1;
+        errno = e;
+        return ret;
+}
+#endif
+#endif
@@ -0,0 +1,76 @@
+#ifndef EDITLINE_TELNET_H
+#define EDITLINE_TELNET_H
+
+#include "editline.h"
+
+// Telnet frontend for Linux. Serves any number of sessions from one thread
+// with non-blocking sockets and epoll, each with its own struct editline.
+// Output for a session is collected while its input is processed and written
+// in one go.
+//
+// This file provides user_putchar, which writes to the session currently
+// being served, so it cannot be combined with your own user_putchar. With
+// ENABLE_TXQUEUE it compiles to nothing.
+
+#ifndef EDITLINE_TELNET_OBUF
+#define EDITLINE_TELNET_OBUF 2048  /* per session output buffer */
+#endif
+
+// events passed to the callback in addition to EL_REDRAW, EL_COMMAND and
+// EL_UNKNOWN from editline_process_char.
+enum {
+        EL_CONNECT = EL_UNKNOWN + 1,    // new session, before the first redraw
+        EL_DISCONNECT,                  // session is about to be freed
+        EL_RESIZE                       // client reported its window size, with
+                                        // ENABLE_MULTILINE the command is already
+                                        // laid out for it
+};
+
+struct editline_session {
+        struct editline el;
+        int fd;
+        uint16_t width, height;         // from NAWS, 0 if unknown
+        void *user;
+        struct editline_session *next;  // see editline_telnet_sessions
+
+        // private
+        struct editline_session *prev;
+        uint8_t tstate, verb, sb[5], sblen;
+        bool cr, closing, dead, pollout;
+        int olen;
+        char obuf[EDITLINE_TELNET_OBUF];
+};
+
+// called for each event on a session. On EL_COMMAND you need to call
+// editline_command_complete as usual.
+typedef void editline_telnet_fn(struct editline_session *s, int event);
+
+// open a listening socket, addr may be NULL for any. Returns the fd or -1.
+int editline_telnet_listen(const char *addr, int port);
+
+// serve connections on the listening socket until editline_telnet_stop is
+// called, returns 0 then or -1 on error with errno set.
+int editline_telnet_serve(int listen_fd, editline_telnet_fn *fn);
+void editline_telnet_stop(void);
+
+// the session being served, for use from command handlers.
+struct editline_session *editline_telnet_current(void);
+
+// all open sessions, follow next for the rest.
+struct editline_session *editline_telnet_sessions(void);
+
+// queue output for a session, '\n' is sent as "\r\n".
+void editline_telnet_write(struct editline_session *s, const char *buf, int len);
+int editline_telnet_printf(struct editline_session *s, const char *fmt, ...)
+        __attribute__((format(printf, 2, 3)));
+
+// print msg above the command line of a session, which need not be the
+// current one, and redraw the line after it. msg should end in '\n'.
+void editline_telnet_message(struct editline_session *s, const char *msg);
+
+// close the session once its pending output has been sent. Output from the
+// editor itself is dropped from then on, so calling editline_command_complete
+// after closing from a command does not draw another prompt.
+void editline_telnet_close(struct editline_session *s);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * A command table generated from names with C escapes, which have to be
+ * hashed and sorted as the bytes the compiler stores, and one generated from
+ * an empty definitions file. Also the results of editline_dispatch and that
+ * editline_insert refuses bytes a command cannot hold.
+ */
+#include "editline_commands.h"
+#include "commands.def"
+#include <stdio.h>
+#include <string.h>
+
+extern const struct editline_cmdtab editline_commands, empty_commands;
+
+static struct editline el = EDITLINE_INIT;
+static int failed;
+
+void user_putchar(char ch)
+{
+}
+
+int cmd_args(int argc, char **argv)
+{
+        return argc;
+}
+
+static void expect(bool ok, const char *what)
+{
+        if (!ok) {
+                printf("FAIL %s\n", what);
+                failed++;
+        }
+}
+
+static int dispatch(const char *cmd)
+{
+        while (*cmd)
+                editline_process_char(&el, *cmd++);
+        expect(editline_process_char(&el, '\r') == EL_COMMAND, "command");
+        int ret = editline_dispatch(&el, &editline_commands);
+        editline_command_complete(&el, true);
+        return ret;
+}
+
+int main(void)
+{
+        static const char *const names[] = {
+                "ABC", "args", "argz", "say\"", "tab\there",
+        };
+        const struct editline_cmdtab *t = &editline_commands;
+
+        expect(t->n == sizeof(names) / sizeof(*names), "number of commands");
+        for (int i = 0; i < t->n; i++) {
+                int j = editline_lookup(t, names[i]);
+                expect(j == i && !strcmp(t->cmd[j].name, names[i]), names[i]);
+        }
+        expect(editline_lookup(t, "arg") < 0, "prefix not found");
+        expect(editline_lookup(t, "\\x61rgz") < 0, "escaped text not found");
+
+        expect(dispatch("args a 'b c'") == 3, "argument count");
+        expect(dispatch("  ") == 0, "empty command");
+        expect(dispatch("nope") == EL_CMD_UNKNOWN, "unknown command");
+        expect(dispatch("args \"a") == EL_CMD_SYNTAX, "unterminated quote");
+        expect(dispatch("args 1 2 3 4 5 6 7") == EDITLINE_MAXARGS, "most arguments");
+        expect(dispatch("args 1 2 3 4 5 6 7 8") == EL_CMD_TOOMANY, "too many arguments");
+
+        expect(!editline_insert(&el, "\351abc", 4) && !el.len, "high bit refused");
+        expect(!editline_insert(&el, "a\0b", 3) && !el.len, "NUL refused");
+        expect(dispatch("ABC") == 1, "command after refused insert");
+
+        expect(!empty_commands.n && editline_lookup(&empty_commands, "args") < 0, "empty table");
+        if (failed)
+                return 1;
+        printf("commands: ok\n");
+        return 0;
+}
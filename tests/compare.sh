@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# usage: compare.sh [-r rev] [seeds]
+#
+# Types random keys into editline built with VT output and with ENABLE_BINARY,
+# the binary output rendered through tools/el_decode, and checks the screens
+# match after every key. With -r the VT output of src/ at git revision rev is
+# compared too, a revision from before editline_putchar has the driver's own
+# output go to user_putchar. Run from tests/ after make, which builds
+# compare_keys, compare_keys_binary, vtrender and el_decode.
+
+rev=
+if [ "$1" = -r ]; then
+	rev=$2
+	shift 2
+fi
+seeds=${1:-500}
+CC=${CC:-cc}
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+if [ -n "$rev" ]; then
+	mkdir "$tmp/old"
+	git -C .. archive "$rev" src | tar -x -C "$tmp/old" || exit 1
+	# before editline_putchar user output went straight to user_putchar
+	old=
+	grep -q editline_putchar "$tmp/old/src/editline.h" ||
+		old=-Deditline_putchar=user_putchar
+	$CC -O2 $old -I"$tmp/old/src" -o "$tmp/compare_keys_old" compare_keys.c \
+		"$tmp/old/src/editline.c" || exit 1
+fi
+
+failed=0
+seed=1
+while [ $seed -le "$seeds" ]; do
+	./compare_keys $seed | ./vtrender > "$tmp/vt"
+	./compare_keys_binary $seed | ./el_decode - | ./vtrender > "$tmp/binary"
+	if ! cmp -s "$tmp/vt" "$tmp/binary"; then
+		echo "FAIL seed $seed, binary differs from VT:"
+		diff "$tmp/vt" "$tmp/binary" | head -20
+		failed=1
+	fi
+	if [ -n "$rev" ]; then
+		"$tmp/compare_keys_old" $seed | ./vtrender > "$tmp/old.vt"
+		if ! cmp -s "$tmp/old.vt" "$tmp/vt"; then
+			echo "FAIL seed $seed, VT differs from $rev:"
+			diff "$tmp/old.vt" "$tmp/vt" | head -20
+			failed=1
+		fi
+	fi
+	seed=$((seed + 1))
+done
+[ $failed = 0 ] || exit 1
+echo "compare: $seeds seeds ok${rev:+, VT same as $rev}"
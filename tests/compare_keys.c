@@ -0,0 +1,72 @@
+/*
+ * Types seed's random keys into one instance and writes the raw output to
+ * standard output for compare.sh, with an RS byte after each key so that
+ * vtrender checks the screen there.
+ */
+#include "editline.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NKEYS 400
+
+void user_putchar(char ch)
+{
+        putchar((unsigned char)ch);
+}
+
+static void out(const char *s)
+{
+        while (*s)
+                editline_putchar(*s++);
+}
+
+static const char *const keys[] = {
+        "\001", "\002", "\004", "\005", "\006", "\010", "\177", "\013", "\020",
+        "\016", "\024", "\025", "\027", "\021", "\003", "\r", "\033d", "\033u",
+        "\033l", "\033c", "\033t", "\033f", "\033b", "\033\177", "\033[A",
+        "\033[B", "\033[C", "\033[D", "\033[3~", "\033[5~", "\014",
+};
+
+int main(int argc, char **argv)
+{
+        struct editline el = EDITLINE_INIT;
+
+        if (argc != 2) {
+                fprintf(stderr, "usage: compare_keys seed\n");
+                return 1;
+        }
+        srand(atoi(argv[1]));
+        editline_redraw(&el);
+        for (int k = 0; k < NKEYS; k++) {
+                char tmp[2] = { 0 };
+                const char *s = tmp;
+
+                if (rand() % 100 < 55)
+                        tmp[0] = " abcdefgh xyz"[rand() % 13];
+                else
+                        s = keys[rand() % (sizeof(keys) / sizeof(*keys))];
+                for (; *s; s++) {
+                        switch (editline_process_char(&el, *s)) {
+                        case EL_REDRAW:
+                                reserve_statuslines(&el, 1);
+                                begin_statusline(&el, 0);
+                                out("status");
+                                end_statusline(&el);
+                                break;
+                        case EL_COMMAND:
+                                out("ran ");
+                                out(el.buf);
+                                out("\r\n");
+                                editline_command_complete(&el, rand() % 4);
+                                break;
+                        }
+                }
+                if (k % 37 == 36) {
+                        editline_hide_command(&el);
+                        out("message\r\n");
+                        editline_restore_command(&el);
+                }
+                putchar('\036');
+        }
+        return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Escape sequence decoding: the keys it knows, and unknown CSI sequences
+ * with parameters dropped whole and counted once in unknown_escapes.
+ */
+#include "editline.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failed;
+
+void user_putchar(char ch)
+{
+}
+
+/* type keys into a new instance, the command must be want */
+static void check(const char *keys, const char *want, int unknown)
+{
+        struct editline el = EDITLINE_INIT;
+        struct editline_stats st;
+
+        for (const char *k = keys; *k; k++)
+                editline_process_char(&el, *k);
+        editline_get_stats(&el, &st, false);
+        if (strcmp(el.buf, want) || st.unknown_escapes != unknown) {
+                printf("FAIL \"");
+                for (const char *k = keys; *k; k++)
+                        printf(*k == '\033' ? "ESC" : "%c", *k);
+                printf("\" gave \"%s\" and %u unknown, want \"%s\" and %d\n",
+                       el.buf, st.unknown_escapes, want, unknown);
+                failed++;
+        }
+}
+
+int main(void)
+{
+        check("ab\033[D\033[Dx", "xab", 0);
+        check("ab\033[1~x\033[4~y", "xaby", 0);
+        check("abc\033[1~\033[3~", "bc", 0);
+        check("ab\033bx\033fy", "xaby", 0);
+        check("\033[1;5C abc\033[2~ x", " abc x", 2);
+        check("a\033[12~b", "ab", 1);
+        check("a\033[?25hb", "ab", 1);
+        check("a\033[Zb", "ab", 1);
+        check("a\033[1;2\033[Db", "ba", 1);
+        if (failed)
+                return 1;
+        printf("escapes: ok\n");
+        return 0;
+}
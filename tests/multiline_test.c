@@ -0,0 +1,111 @@
+/*
+ * Status lines with ENABLE_MULTILINE. After every key of a random session in a
+ * narrow terminal, so the command wraps and the cursor is on any of its rows,
+ * three status lines are written with a begin_statusline for each and one
+ * end_statusline. The cursor must be back where it was, the command rows
+ * untouched and the status lines at the top.
+ */
+#include "editline.h"
+#include "vt.h"
+#include <stdlib.h>
+
+#define NKEYS 400
+#define NSTATUS 3
+
+void user_putchar(char ch)
+{
+        vt_putc(ch);
+}
+
+static void out(const char *s)
+{
+        while (*s)
+                editline_putchar(*s++);
+}
+
+static const char *const keys[] = {
+        "\001", "\002", "\005", "\006", "\010", "\013", "\025", "\027", "\020",
+        "\016", "\r", "\\\r", "\033b", "\033f", "\033[A", "\033[B", "\014",
+};
+
+static int run(unsigned seed, int cols)
+{
+        static char scr[VT_ROWS][VT_MAXCOLS];
+        struct editline el = EDITLINE_INIT;
+        char line[16];
+
+        srand(seed);
+        vt_reset(cols);
+        editline_set_columns(&el, cols);
+        reserve_statuslines(&el, NSTATUS);
+        for (int k = 0; k < NKEYS; k++) {
+                char tmp[2] = { 0 };
+                const char *s = tmp;
+
+                if (rand() % 100 < 60)
+                        tmp[0] = "abcdef gh"[rand() % 9];
+                else
+                        s = keys[rand() % (sizeof(keys) / sizeof(*keys))];
+                for (; *s; s++) {
+                        switch (editline_process_char(&el, *s)) {
+                        case EL_REDRAW:
+                                reserve_statuslines(&el, NSTATUS);
+                                break;
+                        case EL_COMMAND:
+                                out("\r\nran\r\n");
+                                editline_command_complete(&el, true);
+                                break;
+                        }
+                }
+
+                int row = vt_row, col = vt_col;
+                memcpy(scr, vt_scr, sizeof(scr));
+                for (int n = 0; n < NSTATUS; n++) {
+                        begin_statusline(&el, n);
+                        snprintf(line, sizeof(line), "status %d.%d", n, k);
+                        out(line);
+                }
+                end_statusline(&el);
+
+                if (vt_row != row || vt_col != col) {
+                        printf("FAIL seed %u, %d columns, key %d: cursor at %d,%d, want %d,%d\n",
+                               seed, cols, k, vt_row, vt_col, row, col);
+                        return 1;
+                }
+                for (int n = 0; n < NSTATUS; n++) {
+                        snprintf(line, sizeof(line), "status %d.%d", n, k);
+                        if (strcmp(vt_line(n), line)) {
+                                printf("FAIL seed %u, %d columns, key %d: status line %d\n",
+                                       seed, cols, k, n);
+                                return 1;
+                        }
+                }
+                if (memcmp(scr[NSTATUS], vt_scr[NSTATUS], sizeof(scr) - sizeof(scr[0]) * NSTATUS)) {
+                        printf("FAIL seed %u, %d columns, key %d: command changed\n",
+                               seed, cols, k);
+                        return 1;
+                }
+                if (vt_bad) {
+                        printf("FAIL seed %u, %d columns, key %d: bad output\n", seed, cols, k);
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+int main(int argc, char **argv)
+{
+        static const int widths[] = { 16, 20, 80 };
+        int seeds = argc > 1 ? atoi(argv[1]) : 100;
+
+        for (int seed = 1; seed <= seeds; seed++) {
+                for (unsigned w = 0; w < sizeof(widths) / sizeof(*widths); w++) {
+                        if (run(seed, widths[w])) {
+                                vt_dump(stdout);
+                                return 1;
+                        }
+                }
+        }
+        printf("multiline: %d seeds ok\n", seeds);
+        return 0;
+}
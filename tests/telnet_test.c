@@ -0,0 +1,283 @@
+/*
+ * The telnet frontend over loopback. A child process serves, the parent is
+ * the client and checks option negotiation, NAWS with an escaped IAC, CR LF
+ * and CR NUL giving a single return, that the output for a batch of input is
+ * written with one call, and closing from a command, from another session and
+ * from the client. The server counts its writes with -Wl,--wrap=write.
+ */
+#define _GNU_SOURCE 1
+#include "editline_telnet.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define IAC     "\377"
+#define SB      "\372"
+#define SE      "\360"
+#define WILL    "\373"
+#define WONT    "\374"
+#define DO      "\375"
+#define DONT    "\376"
+
+/* server side */
+
+static int writes, connects, disconnects;
+
+ssize_t __real_write(int fd, const void *buf, size_t n);
+
+ssize_t __wrap_write(int fd, const void *buf, size_t n)
+{
+        writes++;
+        return __real_write(fd, buf, n);
+}
+
+static void command(struct editline_session *s, int argc, char **argv)
+{
+        if (!strcmp(argv[0], "size")) {
+                editline_telnet_printf(s, "size %dx%d\n", s->width, s->height);
+        } else if (!strcmp(argv[0], "writes")) {
+                editline_telnet_printf(s, "writes %d\n", writes);
+        } else if (!strcmp(argv[0], "who")) {
+                int n = 0;
+                for (struct editline_session *o = editline_telnet_sessions(); o; o = o->next)
+                        n++;
+                editline_telnet_printf(s, "sessions %d\n", n);
+        } else if (!strcmp(argv[0], "kick")) {
+                for (struct editline_session *o = editline_telnet_sessions(); o; o = o->next)
+                        if (o != s)
+                                editline_telnet_close(o);
+        } else if (!strcmp(argv[0], "quit")) {
+                editline_telnet_printf(s, "bye\n");
+                editline_telnet_close(s);
+        } else if (!strcmp(argv[0], "stop")) {
+                editline_telnet_stop();
+        }
+}
+
+static void event(struct editline_session *s, int ev)
+{
+        char *argv[8];
+        int argc;
+
+        switch (ev) {
+        case EL_CONNECT:
+                connects++;
+                editline_telnet_printf(s, "hello\n");
+                break;
+        case EL_DISCONNECT:
+                disconnects++;
+                break;
+        case EL_COMMAND:
+                argc = editline_tokenize(&s->el, argv, 8);
+                editline_telnet_printf(s, "args:");
+                for (int i = 0; i < argc; i++)
+                        editline_telnet_printf(s, "<%s>", argv[i]);
+                editline_telnet_printf(s, "\n");
+                if (argc > 0)
+                        command(s, argc, argv);
+                editline_command_complete(&s->el, true);
+                break;
+        }
+}
+
+/* client side */
+
+struct conn {
+        int fd;
+        int len;
+        char buf[8192];
+};
+
+static int port;
+
+static void fail(struct conn *c, const char *what)
+{
+        printf("FAIL %s, received:\n", what);
+        for (int i = 0; c && i < c->len; i++) {
+                unsigned char ch = c->buf[i];
+                printf(ch < ' ' || ch > '~' ? "\\%03o" : "%c", ch);
+        }
+        printf("\n");
+        exit(1);
+}
+
+static void conn_open(struct conn *c)
+{
+        struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(port) };
+        struct timeval tv = { .tv_sec = 5 };
+
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        c->len = 0;
+        c->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+                fail(NULL, "connect");
+        setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static void put(struct conn *c, const char *s, int len)
+{
+        if (send(c->fd, s, len, 0) != len)
+                fail(c, "send");
+}
+
+#define PUT(c, s)       put(c, s, sizeof(s) - 1)
+
+/* read until s has been received, returns where it ends */
+static char *expect(struct conn *c, const char *s, int len)
+{
+        for (;;) {
+                char *p = memmem(c->buf, c->len, s, len);
+                if (p)
+                        return p + len;
+                int n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+                if (n <= 0) {
+                        printf("waiting for \"%.*s\"\n", len, s);
+                        fail(c, n ? "timeout" : "connection closed");
+                }
+                c->len += n;
+        }
+}
+
+#define EXPECT(c, s)    expect(c, s, sizeof(s) - 1)
+
+/* forget what was received up to p */
+static void consume(struct conn *c, char *p)
+{
+        c->len -= p - c->buf;
+        memmove(c->buf, p, c->len);
+}
+
+/* the number following s, forgetting what was received up to its line end */
+static int reply(struct conn *c, const char *s)
+{
+        consume(c, expect(c, s, strlen(s)));
+        char *e = expect(c, "\n", 1);
+        int n = atoi(c->buf);
+        consume(c, e);
+        return n;
+}
+
+static int count(struct conn *c, const char *s)
+{
+        int n = 0;
+        for (char *p = c->buf; (p = memmem(p, c->buf + c->len - p, s, strlen(s))); p++)
+                n++;
+        return n;
+}
+
+static void wait_closed(struct conn *c)
+{
+        int n;
+        while ((n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0)) > 0)
+                c->len += n;
+        if (n < 0)
+                fail(c, "session not closed");
+        close(c->fd);
+}
+
+static void client(void)
+{
+        static struct conn a, b, c;
+
+        /* we offer echo and suppress go ahead and ask for the window size */
+        conn_open(&a);
+        char *p = EXPECT(&a, IAC WILL "\001" IAC WILL "\003" IAC DO "\037" "hello\r\n");
+        if (p != a.buf + 16)
+                fail(&a, "negotiation");
+        consume(&a, p);
+
+        /* other options are refused, NAWS with an escaped 255 in it */
+        PUT(&a, IAC DO "\030" IAC WILL "\030" IAC WILL "\037");
+        PUT(&a, IAC SB "\037" "\001" IAC IAC "\000" "\036" IAC SE "size\r\n");
+        consume(&a, EXPECT(&a, IAC WONT "\030" IAC DONT "\030"));
+        consume(&a, EXPECT(&a, "size 511x30\r\n"));
+
+        /* return as CR LF, CR NUL, bare CR and a CR LF split over two reads */
+        PUT(&a, "x a\r\nx b\r");
+        put(&a, "\0x c\rx d\r", 9);
+        usleep(50000);
+        PUT(&a, "\nx e\r\n");
+        EXPECT(&a, "args:<x><e>\r\n");
+        if (count(&a, "args:<x>") != 5 || count(&a, "args:\r\n"))
+                fail(&a, "returns");
+        a.len = 0;
+
+        /* the output for input read in one go is written once */
+        PUT(&a, "writes\r\n");
+        int before = reply(&a, "writes ");
+        PUT(&a, "x 1\r\nx 2\r\nx 3\r\nwrites\r\n");
+        int after = reply(&a, "writes ");
+        if (after != before + 1) {
+                printf("%d writes for one batch\n", after - before - 1);
+                fail(&a, "batching");
+        }
+
+        /* closing another session and a client closing its end */
+        conn_open(&b);
+        conn_open(&c);
+        EXPECT(&b, "hello\r\n");
+        EXPECT(&c, "hello\r\n");
+        PUT(&a, "who\r\n");
+        if (reply(&a, "sessions ") != 3)
+                fail(&a, "three sessions");
+        close(c.fd);
+        PUT(&b, "kick\r\n");
+        wait_closed(&a);
+        for (int tries = 0;; tries++) {
+                /* c may not have been freed yet */
+                PUT(&b, "who\r\n");
+                if (reply(&b, "sessions ") == 1)
+                        break;
+                if (tries == 100)
+                        fail(&b, "one session");
+                usleep(10000);
+        }
+
+        /* quit prints bye, and the session closes without a new prompt */
+        PUT(&b, "quit\r\n");
+        wait_closed(&b);
+        char *bye = expect(&b, "bye\r\n", 5);
+        if (bye != b.buf + b.len)
+                fail(&b, "output after bye");
+
+        conn_open(&a);
+        PUT(&a, "stop\r\n");
+        wait_closed(&a);
+}
+
+int main(void)
+{
+        struct sockaddr_in sa;
+        socklen_t len = sizeof(sa);
+        int fd = editline_telnet_listen("127.0.0.1", 0), status;
+
+        if (fd < 0 || getsockname(fd, (struct sockaddr *)&sa, &len) < 0) {
+                perror("listen");
+                return 1;
+        }
+        port = ntohs(sa.sin_port);
+        signal(SIGPIPE, SIG_IGN);
+        pid_t pid = fork();
+        if (!pid) {
+                int ret = editline_telnet_serve(fd, event);
+                if (ret < 0 || connects != 4 || disconnects != connects) {
+                        printf("FAIL serve returned %d, %d connects and %d disconnects\n",
+                               ret, connects, disconnects);
+                        _exit(1);
+                }
+                _exit(0);
+        }
+        close(fd);
+        client();
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status))
+                fail(NULL, "server");
+        printf("telnet: ok\n");
+        return 0;
+}
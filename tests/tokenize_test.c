@@ -0,0 +1,157 @@
+/*
+ * editline_tokenize against a simple copying tokenizer, on fixed cases and on
+ * random commands typed into one instance so history builds up. Some commands
+ * are tokenized twice, which must give the same arguments. After
+ * editline_command_complete the command must be in history as typed and the
+ * history before it intact, apart from the end of the oldest entry.
+ */
+#include "editline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXARGS 8
+
+void user_putchar(char ch)
+{
+}
+
+static struct editline el = EDITLINE_INIT;
+static int failed, passes = 1;
+
+/* the rules of editline_tokenize, writing the arguments out to a copy */
+static int reference(const char *b, char out[][EDITLINE_BUFSIZE], int max)
+{
+        int len = strlen(b), rd = 0, argc = 0;
+
+        for (;;) {
+                while (b[rd] == ' ' || (b[rd] == '\\' && b[rd + 1] == '\n'))
+                        rd += b[rd] == ' ' ? 1 : 2;
+                if (!b[rd])
+                        return argc;
+                if (argc == max)
+                        return -2;
+                char *w = out[argc++], q = 0;
+                for (; b[rd] && (q || b[rd] != ' '); rd++) {
+                        if (!q && b[rd] == '\\' && b[rd + 1] == '\n')
+                                break;
+                        if (q != '\'' && b[rd] == '\\' && rd + 1 < len &&
+                            (!q || b[rd + 1] == '"' || b[rd + 1] == '\\'))
+                                *w++ = b[++rd];
+                        else if (b[rd] == '"' && q != '\'')
+                                q = q ? 0 : '"';
+                        else if (b[rd] == '\'' && q != '"')
+                                q = q ? 0 : '\'';
+                        else
+                                *w++ = b[rd];
+                }
+                if (q)
+                        return -1;
+                *w = 0;
+        }
+}
+
+static void show(const char *what, const char *cmd)
+{
+        printf("FAIL %s: ", what);
+        for (; *cmd; cmd++)
+                printf(*cmd == '\n' ? "\\n" : "%c", *cmd);
+        printf("\n");
+        failed++;
+}
+
+/* tokenize the command in el, which has just returned EL_COMMAND */
+static void check(int max)
+{
+        char cmd[EDITLINE_BUFSIZE], hist[EDITLINE_BUFSIZE];
+        char want[MAXARGS + 1][EDITLINE_BUFSIZE], *argv[MAXARGS];
+        int len = el.len;
+
+        strcpy(cmd, el.buf);
+        memcpy(hist, el.buf + len + 1, EDITLINE_BUFSIZE - (len + 1));
+        int n = reference(cmd, want, max);
+        for (int pass = 0; pass < passes; pass++) {
+                int argc = editline_tokenize(&el, argv, max);
+                if (argc != n) {
+                        show("argument count", cmd);
+                        printf("  got %d, want %d on pass %d\n", argc, n, pass);
+                }
+                for (int i = 0; i < argc && i < n; i++) {
+                        if (strcmp(argv[i], want[i])) {
+                                show("argument", cmd);
+                                printf("  %d is \"%s\", want \"%s\" on pass %d\n",
+                                       i, argv[i], want[i], pass);
+                        }
+                }
+        }
+        editline_command_complete(&el, true);
+        if (cmd[0] && strcmp(el.buf + 1, cmd))
+                show("history", cmd);
+        int keep = EDITLINE_BUFSIZE - (len + 2) - EDITLINE_BUFSIZE / 31;
+        if (cmd[0] && keep > 0 && memcmp(el.buf + len + 2, hist, keep))
+                show("older history", cmd);
+}
+
+static void type(const char *s, int max)
+{
+        for (; *s; s++) {
+                if (editline_process_char(&el, *s == '\n' ? '\r' : *s) == EL_COMMAND)
+                        check(max);
+        }
+        if (editline_process_char(&el, '\r') == EL_COMMAND)
+                check(max);
+}
+
+int main(int argc, char **argv)
+{
+        static const char *const cases[] = {
+                "",
+                "   ",
+                "cd My\\ Documents/projects/firmware/build/output",
+                "a\\ bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb",
+                "\"a\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb",
+                "\"x\\\" cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\"",
+                "'q' dd\"dddddddddddddddddddddddddddddddddddddddddddddddddddddddddd\"d",
+                "x 'eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee\\\" a\\ b",
+                "\\ 0123456789012345678901234567890 \\ 0123456789012345678901234567890",
+                "\\a0123456789012345678901234567890123456789012345678901234567890123456789"
+                "012345678901234567890123456789012345678901234567890",
+                "a b c d e f g h",
+                "a b c d e f g h i",
+                "a b c d e f g h \"i",
+                "a 'b",
+                "a \"b\\\"",
+                "trailing\\",
+                "echo \"a b\" c\\ d",
+        };
+
+        for (passes = 1; passes <= 2; passes++) {
+                for (unsigned i = 0; i < sizeof(cases) / sizeof(*cases); i++)
+                        type(cases[i], MAXARGS);
+                type("one two three", 2);
+        }
+
+        /* with a large buffer the count needs two extension bytes */
+        char longest[EDITLINE_BUFSIZE] = "\\ ";
+        memset(longest + 2, 'x', EDITLINE_BUFSIZE - 3);
+        type(longest, MAXARGS);
+
+        /* return continues a command ending in a backslash with multiline */
+        const char *special = ENABLE_MULTILINE ? "a \"'\\\n" : "a \"'\\";
+        int n = argc > 1 ? atoi(argv[1]) : 20000;
+        srand(1);
+        for (int i = 0; i < n; i++) {
+                char cmd[2 * EDITLINE_BUFSIZE];
+                int len = rand() % (EDITLINE_BUFSIZE + 20), runs = rand() % 4;
+                for (int j = 0; j < len; j++)
+                        cmd[j] = rand() % 8 < runs ? special[rand() % strlen(special)] :
+                                 'a' + rand() % 26;
+                cmd[len] = 0;
+                passes = 1 + rand() % 2;
+                type(cmd, 1 + rand() % MAXARGS);
+        }
+        if (failed)
+                return 1;
+        printf("tokenize: %d commands ok\n", n);
+        return 0;
+}
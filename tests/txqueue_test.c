@@ -0,0 +1,170 @@
+/*
+ * ENABLE_TXQUEUE behind a slow transmitter. The queue is drained only a few
+ * bytes per key, like a UART at low baud, so redraws queued behind unsent
+ * output get collapsed. Whenever the queue runs empty, and once everything
+ * has been sent, the screen must be the same as when the queue is drained
+ * after every key. Collapsing must also have saved bytes, including when keys
+ * come in batches with a status line after each like in the AVR example. The
+ * status line is a barrier that ends a run but must not undo a collapse
+ * already decided. That only shows with a queue large enough not to be full
+ * throughout, built as txqueue_test_128.
+ */
+#include "editline.h"
+#include "vt.h"
+#include <stdlib.h>
+
+static long sent;
+static bool eager, status;
+
+static void uart_send(int max)
+{
+        char c;
+
+        while (max-- && editline_tx_drain(&c, 1)) {
+                vt_putc(c);
+                sent++;
+        }
+}
+
+/*
+ * a full queue waits for the UART to finish a byte. Eager sends each byte as
+ * it is queued so nothing is ever collapsed.
+ */
+void user_tx_kick(void)
+{
+        if (eager || editline_tx_pending() >= EDITLINE_TXQUEUE_SIZE)
+                uart_send(1);
+}
+
+static void out(const char *s)
+{
+        while (*s)
+                editline_putchar(*s++);
+}
+
+
+#define NKEYS 300
+
+struct screen {
+        char scr[VT_ROWS][VT_MAXCOLS];
+        int row, col;
+};
+
+static const char *const keys[] = {
+        "\001", "\002", "\004", "\005", "\006", "\010", "\013", "\025", "\027",
+        "\020", "\016", "\020", "\016", "\020", "\020", "\016", "\016", "\r",
+        "\033b", "\033f", "\033d", "\033t", "\033u", "\033[A", "\033[B", "\014",
+};
+
+static void snapshot(struct screen *s)
+{
+        memcpy(s->scr, vt_scr, sizeof(vt_scr));
+        s->row = vt_row;
+        s->col = vt_col;
+}
+
+static bool same(const struct screen *s)
+{
+        return !memcmp(s->scr, vt_scr, sizeof(vt_scr)) && s->row == vt_row && s->col == vt_col;
+}
+
+/*
+ * feed seed's keys draining budget bytes after each, or after each batch with
+ * status lines. With budget -1 output is sent eagerly and the screen then
+ * saved in want, otherwise it is checked against want whenever the queue is
+ * empty. Returns the key it differs after, NKEYS for the end or -1 if it does
+ * not.
+ */
+static int run(unsigned seed, int budget, struct screen *want)
+{
+        struct editline el = EDITLINE_INIT;
+        int batch = 1;
+
+        srand(seed);
+        vt_reset(VT_MAXCOLS);
+        sent = 0;
+        eager = budget < 0;
+        for (int k = 0; k < NKEYS; k++) {
+                char tmp[2] = { 0 };
+                const char *s = tmp;
+
+                if (rand() % 100 < 50)
+                        tmp[0] = "abcdef gh"[rand() % 9];
+                else
+                        s = keys[rand() % (sizeof(keys) / sizeof(*keys))];
+                for (; *s; s++) {
+                        switch (editline_process_char(&el, *s)) {
+                        case EL_REDRAW:
+                                reserve_statuslines(&el, 1);
+                                begin_statusline(&el, 0);
+                                out("status");
+                                end_statusline(&el);
+                                break;
+                        case EL_COMMAND:
+                                out("\r\nran ");
+                                out(el.buf);
+                                editline_command_complete(&el, true);
+                                break;
+                        }
+                }
+                if (k % 41 == 40) {
+                        editline_hide_command(&el);
+                        out("message\r\n");
+                        editline_restore_command(&el);
+                }
+                /* with status lines the UART only gets to send between batches */
+                if (status && --batch && k < NKEYS - 1)
+                        continue;
+                if (status) {
+                        begin_statusline(&el, 0);
+                        out("status");
+                        end_statusline(&el);
+                        batch = 1 + rand() % 6;
+                }
+                uart_send(budget);
+                if (budget < 0)
+                        snapshot(&want[k]);
+                else if (!editline_tx_pending() && !same(&want[k]))
+                        return k;
+        }
+        uart_send(-1);
+        return same(&want[NKEYS - 1]) ? -1 : NKEYS;
+}
+
+int main(int argc, char **argv)
+{
+        static const int budgets[] = { 1, 2, 3, 5, 8, 13, 40 };
+        static struct screen want[NKEYS];
+        int seeds = argc > 1 ? atoi(argv[1]) : 200;
+
+        for (int with_status = 0; with_status < 2; with_status++) {
+                status = with_status;
+                long fast = 0, slow = 0;
+                const char *how = status ? "with status lines" : "on redraw";
+
+                for (int seed = 1; seed <= seeds; seed++) {
+                        run(seed, -1, want);
+                        fast += sent;
+                        for (unsigned b = 0; b < sizeof(budgets) / sizeof(*budgets); b++) {
+                                int k = run(seed, budgets[b], want);
+                                if (k >= 0) {
+                                        printf("FAIL seed %d, %d bytes per key, %s, after key %d\n",
+                                               seed, budgets[b], how, k);
+                                        vt_dump(stdout);
+                                        return 1;
+                                }
+                                if (budgets[b] == 1)
+                                        slow += sent;
+                        }
+                }
+                /* the redraws collapsed should save at least a tenth */
+                if ((!status || EDITLINE_TXQUEUE_SIZE >= 128) && slow * 10 > fast * 9) {
+                        printf("FAIL too little collapsed %s, %ld bytes slow and %ld fast\n",
+                               how, slow, fast);
+                        return 1;
+                }
+                printf("txqueue: %d seeds ok %s, 1 byte per key sent %ld of %ld bytes\n",
+                       seeds, how, slow, fast);
+        }
+        return 0;
+}
@@ -0,0 +1,183 @@
+#ifndef VT_H
+#define VT_H
+
+/*
+ * Minimal VT100 screen for the tests, it understands what editline sends:
+ * cursor movement, erase in line and display, scroll regions and DECSC/DECRC.
+ * Writing into the last column leaves the cursor there with a pending wrap
+ * like xterm does, editline never should so such writes are counted in
+ * vt_bad along with stray control characters.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define VT_ROWS 24
+#define VT_MAXCOLS 200
+
+static char vt_scr[VT_ROWS][VT_MAXCOLS];
+static int vt_cols = 80, vt_row, vt_col, vt_bad;
+static int vt_top, vt_saved_row, vt_saved_col;
+static int vt_state, vt_nparam, vt_param[4];
+static bool vt_wrap;
+
+static inline void vt_reset(int cols)
+{
+        memset(vt_scr, ' ', sizeof(vt_scr));
+        vt_cols = cols;
+        vt_row = VT_ROWS - 1;
+        vt_col = 0;
+        vt_bad = 0;
+        vt_top = 0;
+        vt_state = 0;
+        vt_wrap = false;
+}
+
+static inline void vt_linefeed(void)
+{
+        if (vt_row < VT_ROWS - 1) {
+                vt_row++;
+                return;
+        }
+        memmove(vt_scr[vt_top], vt_scr[vt_top + 1], (VT_ROWS - 1 - vt_top) * VT_MAXCOLS);
+        memset(vt_scr[VT_ROWS - 1], ' ', VT_MAXCOLS);
+}
+
+static inline void vt_csi(char ch)
+{
+        int n = vt_nparam ? vt_param[0] : 0, n1 = n ? n : 1;
+
+        vt_state = 0;
+        vt_wrap = false;
+        switch (ch) {
+        case 'A':
+                vt_row = vt_row > n1 ? vt_row - n1 : 0;
+                break;
+        case 'B':
+                vt_row = vt_row + n1 < VT_ROWS ? vt_row + n1 : VT_ROWS - 1;
+                break;
+        case 'C':
+                vt_col = vt_col + n1 < vt_cols ? vt_col + n1 : vt_cols - 1;
+                break;
+        case 'D':
+                vt_col = vt_col > n1 ? vt_col - n1 : 0;
+                break;
+        case 'H':
+                vt_row = n1 <= VT_ROWS ? n1 - 1 : VT_ROWS - 1;
+                vt_col = vt_nparam > 1 && vt_param[1] ? vt_param[1] - 1 : 0;
+                break;
+        case 'J':
+                if (n == 0) {
+                        memset(vt_scr[vt_row] + vt_col, ' ', VT_MAXCOLS - vt_col);
+                        for (int r = vt_row + 1; r < VT_ROWS; r++)
+                                memset(vt_scr[r], ' ', VT_MAXCOLS);
+                } else if (n == 2) {
+                        memset(vt_scr, ' ', sizeof(vt_scr));
+                }
+                break;
+        case 'K':
+                memset(vt_scr[vt_row] + vt_col, ' ', VT_MAXCOLS - vt_col);
+                break;
+        case 'r':
+                /* DECSTBM homes the cursor */
+                vt_top = n1 - 1;
+                vt_row = vt_col = 0;
+                break;
+        }
+}
+
+static inline void vt_putc(char c)
+{
+        unsigned char ch = c;
+
+        if (vt_state == 1) {
+                vt_state = 0;
+                if (ch == '[') {
+                        vt_state = 2;
+                        vt_nparam = 0;
+                        memset(vt_param, 0, sizeof(vt_param));
+                } else if (ch == '7') {
+                        vt_saved_row = vt_row;
+                        vt_saved_col = vt_col;
+                } else if (ch == '8') {
+                        vt_row = vt_saved_row;
+                        vt_col = vt_saved_col;
+                        vt_wrap = false;
+                }
+                return;
+        }
+        if (vt_state == 2) {
+                if (ch >= '0' && ch <= '9') {
+                        if (!vt_nparam)
+                                vt_nparam = 1;
+                        vt_param[vt_nparam - 1] = vt_param[vt_nparam - 1] * 10 + ch - '0';
+                } else if (ch == ';') {
+                        if (vt_nparam < 4)
+                                vt_nparam++;
+                } else if (ch != '?') {
+                        vt_csi(ch);
+                }
+                return;
+        }
+        switch (ch) {
+        case '\033':
+                vt_state = 1;
+                return;
+        case '\r':
+                vt_col = 0;
+                vt_wrap = false;
+                return;
+        case '\n':
+                vt_wrap = false;
+                vt_linefeed();
+                return;
+        case '\a':
+                return;
+        }
+        if (ch < ' ') {
+                vt_bad++;
+                return;
+        }
+        if (vt_wrap) {
+                vt_bad++;
+                vt_wrap = false;
+                vt_col = 0;
+                vt_linefeed();
+        }
+        if (vt_col == vt_cols - 1)
+                vt_bad++;
+        vt_scr[vt_row][vt_col] = ch;
+        if (vt_col == vt_cols - 1)
+                vt_wrap = true;
+        else
+                vt_col++;
+}
+
+static inline void vt_puts(const char *s)
+{
+        while (*s)
+                vt_putc(*s++);
+}
+
+/* row r without trailing blanks, valid until the next call */
+static inline const char *vt_line(int r)
+{
+        static char line[VT_MAXCOLS + 1];
+        int n = vt_cols;
+
+        while (n && vt_scr[r][n - 1] == ' ')
+                n--;
+        memcpy(line, vt_scr[r], n);
+        line[n] = 0;
+        return line;
+}
+
+static inline void vt_dump(FILE *f)
+{
+        for (int r = 0; r < VT_ROWS; r++)
+                fprintf(f, "%2d|%s|\n", r, vt_line(r));
+        fprintf(f, "cursor %d,%d\n", vt_row, vt_col);
+}
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Renders standard input on the test terminal. At each RS byte it prints a
+ * hash of the screen and cursor, at the end the screen itself.
+ */
+#include "vt.h"
+#include <stdint.h>
+
+static uint32_t hash(void)
+{
+        uint32_t h = 2166136261u;
+
+        for (int r = 0; r < VT_ROWS; r++)
+                for (int c = 0; c < vt_cols; c++)
+                        h = (h ^ (uint8_t)vt_scr[r][c]) * 16777619;
+        return h ^ (vt_row << 8 | vt_col) * 16777619;
+}
+
+int main(void)
+{
+        int c, key = 0;
+
+        vt_reset(80);
+        while ((c = getchar()) != EOF) {
+                if (c == '\036')
+                        printf("key %d %08x\n", key++, hash());
+                else
+                        vt_putc(c);
+        }
+        vt_dump(stdout);
+        return 0;
+}
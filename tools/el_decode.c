@@ -0,0 +1,406 @@
+/*
+ * Reference decoder for the binary line state protocol of ENABLE_BINARY, see
+ * src/editline_binary.h. It keeps a copy of the line and its history and
+ * renders them with VT100 codes the same way editline.c would.
+ *
+ *      cc -O2 -I../src -o el_decode el_decode.c
+ *
+ * usage: el_decode [-p prompt] [-b baud] device
+ *        el_decode [-p prompt] -
+ *
+ * Given a serial device it forwards your keys to it and renders what comes
+ * back, ^] quits. Given - it decodes standard input to standard output.
+ */
+#define _DEFAULT_SOURCE 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "editline_binary.h"
+
+#define MAXLINE 256     /* lengths and indexes are sent as a byte */
+#define MAXHIST 256
+
+struct line {
+        int len;
+        char text[MAXLINE];
+};
+
+/* hist[0] is the line being edited, shown is the entry on screen */
+static struct line hist[MAXHIST];
+static int nhist = 1, shown, pos;
+static bool visible = true;
+static char prompt = ';';
+
+static uint8_t msg[4 + MAXLINE];
+static int mlen;
+
+static struct line *cur(void)
+{
+        return &hist[shown];
+}
+
+static void move(int n)
+{
+        if (n > 0)
+                printf("\033[%dC", n);
+        else if (n < 0)
+                printf("\033[%dD", -n);
+}
+
+/* draw from the cursor to the end of the line, leaving the cursor in place */
+static void draw_rest(void)
+{
+        if (!visible)
+                return;
+        struct line *l = cur();
+        printf("\033[?25l%.*s\033[K", l->len - pos, l->text + pos);
+        move(-(l->len - pos));
+        printf("\033[?25h");
+}
+
+static void draw_line(void)
+{
+        if (!visible)
+                return;
+        struct line *l = cur();
+        printf("\033[?25l\r");
+        if (prompt)
+                printf("\033[92m%c\033[m", prompt);
+        printf("%.*s\033[K\r", l->len, l->text);
+        move(pos + !!prompt);
+        printf("\033[?25h");
+}
+
+static void set_cursor(int to)
+{
+        if (to < 0)
+                to = 0;
+        if (to > cur()->len)
+                to = cur()->len;
+        if (visible)
+                move(to - pos);
+        pos = to;
+}
+
+/* entry k, made up empty if we joined late and never saw it */
+static struct line *entry(int k)
+{
+        while (nhist <= k)
+                hist[nhist++].len = 0;
+        return &hist[k];
+}
+
+static void push_front(const struct line *l)
+{
+        if (nhist < MAXHIST)
+                nhist++;
+        memmove(hist + 1, hist, (nhist - 1) * sizeof(*hist));
+        hist[0] = *l;
+}
+
+static void remove_entry(int k)
+{
+        memmove(hist + k, hist + k + 1, (nhist - k - 1) * sizeof(*hist));
+        nhist--;
+}
+
+/* the entry shown was edited, it or a copy of it becomes entry 0 */
+static void realize(bool copy)
+{
+        struct line l = *entry(shown);
+        remove_entry(0);
+        if (!copy)
+                remove_entry(shown - 1);
+        push_front(&l);
+        shown = 0;
+}
+
+static void control(int c, const uint8_t *arg)
+{
+        struct line *l;
+        switch (c) {
+        case EL_CTL_NEWLINE:
+                printf("\r\n");
+                visible = false;
+                break;
+        case EL_CTL_DROP:
+                hist[0].len = 0;
+                /* fall through */
+        case EL_CTL_KEEP:
+                if (hist[0].len) {
+                        struct line empty = { 0 };
+                        push_front(&empty);
+                }
+                shown = pos = 0;
+                visible = true;
+                draw_line();
+                break;
+        case EL_CTL_CLEAR:
+                hist[0].len = 0;
+                shown = pos = 0;
+                visible = true;
+                draw_line();
+                break;
+        case EL_CTL_HIDE:
+                printf("\r\033[K");
+                visible = false;
+                break;
+        case EL_CTL_SHOW:
+                visible = true;
+                draw_line();
+                break;
+        case EL_CTL_SCREEN:
+                printf("\033[2J");
+                break;
+        case EL_CTL_LINE:
+                l = entry(arg[0]);
+                l->len = arg[1];
+                memcpy(l->text, arg + 2, l->len);
+                shown = arg[0];
+                pos = arg[2 + l->len] <= l->len ? arg[2 + l->len] : l->len;
+                visible = true;
+                draw_line();
+                break;
+        case EL_CTL_MOVE:
+        case EL_CTL_COPY:
+                if (shown)
+                        realize(c == EL_CTL_COPY);
+                break;
+        case EL_CTL_RESERVE:
+                printf("\033[%d;999r", arg[0] + 1);
+                break;
+        case EL_CTL_STATUS:
+                printf("\033[?25l\033[%dH\r", arg[0] + 1);
+                break;
+        case EL_CTL_STATUS_END:
+                printf("\033[K\033[999H\r");
+                move(pos + 1);
+                printf("\033[?25h");
+                break;
+        case EL_CTL_LIT:
+                putchar(arg[0]);
+                break;
+        }
+}
+
+static void operation(int op, int n, const uint8_t *arg)
+{
+        struct line *l = cur();
+        switch (op) {
+        case EL_OP_INS:
+                if (l->len + n > MAXLINE)
+                        n = MAXLINE - l->len;
+                memmove(l->text + pos + n, l->text + pos, l->len - pos);
+                memcpy(l->text + pos, arg, n);
+                l->len += n;
+                if (visible)
+                        printf("%.*s", n, l->text + pos);
+                pos += n;
+                draw_rest();
+                break;
+        case EL_OP_DEL:
+                if (n > l->len - pos)
+                        n = l->len - pos;
+                memmove(l->text + pos, l->text + pos + n, l->len - pos - n);
+                l->len -= n;
+                draw_rest();
+                break;
+        case EL_OP_LEFT:
+                set_cursor(pos - n);
+                break;
+        case EL_OP_RIGHT:
+                set_cursor(pos + n);
+                break;
+        case EL_OP_CUR:
+                set_cursor(n);
+                break;
+        case EL_OP_OVR:
+                if (n > l->len - pos)
+                        n = l->len - pos;
+                memcpy(l->text + pos, arg, n);
+                draw_rest();
+                break;
+        case EL_OP_HIST:
+                entry(n);
+                shown = n;
+                pos = cur()->len;
+                draw_line();
+                break;
+        case EL_OP_CTL:
+                control(n, arg);
+                break;
+        }
+}
+
+/* bytes needed for the operation started in msg, or 0 if not known yet */
+static int op_length(void)
+{
+        int op = msg[0] >> 4 & 7, n = msg[0] & 15, hdr = 1;
+        if (n == EL_OP_EXT) {
+                if (mlen < 2)
+                        return 0;
+                n = msg[1];
+                hdr = 2;
+        }
+        switch (op) {
+        case EL_OP_INS:
+        case EL_OP_OVR:
+                return hdr + n;
+        case EL_OP_CTL:
+                switch (n) {
+                case EL_CTL_LINE:
+                        return mlen < hdr + 2 ? 0 : hdr + 2 + msg[hdr + 1] + 1;
+                case EL_CTL_RESERVE:
+                case EL_CTL_STATUS:
+                case EL_CTL_LIT:
+                        return hdr + 1;
+                }
+        }
+        return hdr;
+}
+
+static void decode(uint8_t b)
+{
+        if (!mlen && !(b & 0x80)) {
+                putchar(b);
+                return;
+        }
+        msg[mlen++] = b;
+        int need = op_length();
+        if (!need || mlen < need)
+                return;
+        int n = msg[0] & 15, hdr = 1;
+        if (n == EL_OP_EXT) {
+                n = msg[1];
+                hdr = 2;
+        }
+        mlen = 0;
+        operation(msg[0] >> 4 & 7, n, msg + hdr);
+}
+
+static struct termios saved;
+
+static void restore_tty(void)
+{
+        tcsetattr(0, TCSANOW, &saved);
+}
+
+static speed_t baud(int b)
+{
+        switch (b) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        }
+        fprintf(stderr, "el_decode: unsupported baud rate %d\n", b);
+        exit(1);
+}
+
+/* the device may take a write in pieces, and if it goes away we are done */
+static void write_all(int fd, const uint8_t *p, int n)
+{
+        while (n > 0) {
+                ssize_t w = write(fd, p, n);
+                if (w < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        perror("write");
+                        exit(1);
+                }
+                p += w;
+                n -= w;
+        }
+}
+
+static int open_device(const char *path, int rate)
+{
+        int fd = open(path, O_RDWR | O_NOCTTY);
+        if (fd < 0) {
+                perror(path);
+                exit(1);
+        }
+        struct termios t;
+        if (!tcgetattr(fd, &t)) {
+                cfmakeraw(&t);
+                if (rate) {
+                        cfsetispeed(&t, baud(rate));
+                        cfsetospeed(&t, baud(rate));
+                }
+                tcsetattr(fd, TCSANOW, &t);
+        }
+        return fd;
+}
+
+int main(int argc, char *argv[])
+{
+        int opt, rate = 0;
+        while ((opt = getopt(argc, argv, "p:b:")) != -1) {
+                switch (opt) {
+                case 'p': prompt = optarg[0]; break;
+                case 'b': rate = atoi(optarg); break;
+                default: goto usage;
+                }
+        }
+        if (optind != argc - 1)
+                goto usage;
+        uint8_t buf[512];
+        int n;
+        if (!strcmp(argv[optind], "-")) {
+                while ((n = read(0, buf, sizeof(buf))) > 0) {
+                        for (int i = 0; i < n; i++)
+                                decode(buf[i]);
+                        fflush(stdout);
+                }
+                return 0;
+        }
+        int fd = open_device(argv[optind], rate);
+        if (isatty(0) && !tcgetattr(0, &saved)) {
+                struct termios t = saved;
+                cfmakeraw(&t);
+                tcsetattr(0, TCSANOW, &t);
+                atexit(restore_tty);
+        }
+        /* have the device redraw so we start in step */
+        write_all(fd, (const uint8_t *)"\014", 1);
+        struct pollfd p[2] = { { .fd = 0, .events = POLLIN }, { .fd = fd, .events = POLLIN } };
+        for (;;) {
+                if (poll(p, 2, -1) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        break;
+                }
+                if (p[0].revents) {
+                        if ((n = read(0, buf, sizeof(buf))) <= 0)
+                                break;
+                        if (memchr(buf, 0x1d, n))
+                                break;
+                        write_all(fd, buf, n);
+                }
+                if (p[1].revents) {
+                        if ((n = read(fd, buf, sizeof(buf))) <= 0)
+                                break;
+                        for (int i = 0; i < n; i++)
+                                decode(buf[i]);
+                        fflush(stdout);
+                }
+        }
+        printf("\r\n");
+        return 0;
+usage:
+        fprintf(stderr, "usage: el_decode [-p prompt] [-b baud] device|-\n");
+        return 1;
+}
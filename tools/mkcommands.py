@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Generate a command table for editline_commands.h.
+
+usage: mkcommands.py [-n name] commands.def output.c
+
+Reads EDITLINE_COMMAND(handler, "name", "help") lines from the definitions
+file and writes a C file defining 'const struct editline_cmdtab name'
+(editline_commands by default) with a minimal perfect hash over the names.
+It is built by hash and displace: names are grouped into buckets by
+name_hash(0, name) and each bucket gets a seed that sends all its names to
+free slots. Names may use C escapes, they are hashed and sorted as the bytes
+the compiler will store, and must be ASCII.
+"""
+
+import re
+import sys
+
+DEF = re.compile(r'^\s*EDITLINE_COMMAND\s*\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"'
+                 r'\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+ESCAPES = {'a': 7, 'b': 8, 'f': 12, 'n': 10, 'r': 13, 't': 9, 'v': 11,
+           '\\': 92, "'": 39, '"': 34, '?': 63}
+
+
+def c_string(text):
+    """the bytes of the C string literal text, without the quotes"""
+    out = bytearray()
+    i = 0
+    while i < len(text):
+        if text[i] != '\\':
+            out += text[i].encode()
+            i += 1
+            continue
+        e = text[i + 1]
+        if e in ESCAPES:
+            out.append(ESCAPES[e])
+            i += 2
+            continue
+        m = re.match(r'x([0-9a-fA-F]+)|[0-7]{1,3}', text[i + 1:])
+        value = m and (int(m.group(1), 16) if m.group(1) else int(m.group(0), 8))
+        if not m or value > 0xff:
+            sys.exit('mkcommands: bad escape in "%s"' % text)
+        out.append(value)
+        i += 1 + len(m.group(0))
+    return bytes(out)
+
+
+def name_hash(seed, name):
+    """must match name_hash() in src/editline_commands.c"""
+    h = seed ^ 0x9dc5
+    for c in name:
+        h = ((h ^ c) * 403) & 0xffff
+    return h ^ (h >> 8)
+
+
+def perfect_hash(names):
+    n = len(names)
+    nbuckets = max(1, (n + 1) // 2)
+    buckets = [[] for _ in range(nbuckets)]
+    for i, name in enumerate(names):
+        buckets[name_hash(0, name) % nbuckets].append(i)
+    slot = [None] * n
+    disp = [0] * nbuckets
+    for b in sorted(range(nbuckets), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+        for d in range(0x10000):
+            want = [name_hash(d, names[i]) % n for i in buckets[b]]
+            if len(set(want)) == len(want) and all(slot[s] is None for s in want):
+                break
+        else:
+            sys.exit("mkcommands: no perfect hash found")
+        disp[b] = d
+        for i, s in zip(buckets[b], want):
+            slot[s] = i
+    return slot, disp, nbuckets
+
+
+def c_array(items, per_line=8):
+    lines = []
+    for i in range(0, len(items), per_line):
+        lines.append('        ' + ', '.join(items[i:i + per_line]) + ',')
+    return '\n'.join(lines)
+
+
+def command_table(table, cmds, names):
+    slot, disp, nbuckets = perfect_hash(names)
+    out = []
+    for handler, _, _ in cmds:
+        out.append('int %s(int argc, char **argv);' % handler)
+    out.append('')
+    for i, (_, name, help) in enumerate(cmds):
+        out.append('static const char name_%d[] EL_FLASH = "%s";' % (i, name))
+        out.append('static const char help_%d[] EL_FLASH = "%s";' % (i, help))
+    out.append('')
+    out.append('static const struct editline_command cmd[] EL_FLASH = {')
+    for i, (handler, _, _) in enumerate(cmds):
+        out.append('        { name_%d, %s, help_%d },' % (i, handler, i))
+    out.append('};')
+    out.append('')
+    out.append('static const uint16_t slot[] EL_FLASH = {')
+    out.append(c_array([str(s) for s in slot]))
+    out.append('};')
+    out.append('')
+    out.append('static const uint16_t disp[] EL_FLASH = {')
+    out.append(c_array(['0x%04x' % d for d in disp]))
+    out.append('};')
+    out.append('')
+    out.append('const struct editline_cmdtab %s = { cmd, slot, disp, %d, %d };'
+               % (table, len(cmds), nbuckets))
+    return out
+
+
+def main(argv):
+    table = 'editline_commands'
+    if len(argv) > 1 and argv[1] == '-n':
+        table = argv[2]
+        argv = argv[:1] + argv[3:]
+    if len(argv) != 3:
+        sys.exit(__doc__.split('\n\n')[1])
+    cmds = []
+    with open(argv[1]) as f:
+        for line in f:
+            m = DEF.match(line)
+            if m:
+                cmds.append(m.groups())
+    # sorted by the stored bytes, as strcmp would
+    cmds.sort(key=lambda c: c_string(c[1]))
+    names = [c_string(c[1]) for c in cmds]
+    for a, b in zip(names, names[1:]):
+        if a == b:
+            sys.exit('mkcommands: duplicate command "%s"' % a.decode(errors='replace'))
+    if any(not name or 0 in name for name in names):
+        sys.exit('mkcommands: command names must not be empty or hold a NUL')
+    # they could not be typed, editline keeps the high bit for key codes
+    if any(c >= 0x80 for name in names for c in name):
+        sys.exit('mkcommands: command names must be ASCII')
+
+    out = ['/* generated by mkcommands.py from %s, do not edit. */' % argv[1],
+           '#include "editline_commands.h"', '']
+    if cmds:
+        out += command_table(table, cmds, names)
+    else:
+        # ISO C has no empty arrays
+        out.append('const struct editline_cmdtab %s = { 0, 0, 0, 0, 0 };' % table)
+    with open(argv[2], 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main(sys.argv)